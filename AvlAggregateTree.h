@@ -0,0 +1,194 @@
+#ifndef AVL_AGGREGATE_TREE_H
+#define AVL_AGGREGATE_TREE_H
+
+#include "AvlTree.h"
+#include <limits>
+using namespace std;
+
+// AvlAggregateTree class
+//
+// CONSTRUCTION: with no parameters; Monoid selects the aggregate
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( x )       --> Insert x
+// void remove( x )       --> Remove x
+// bool contains( x )     --> Return true if x is present
+// int size( )            --> Quantity of elements in tree
+// boolean isEmpty( )     --> Return true if empty; else false
+// value aggregate( )     --> Aggregate over every element
+// value aggregate( lo, hi ) --> Aggregate over elements in [lo, hi], O(log n)
+// ******************ERRORS********************************
+// None; empty ranges aggregate to Monoid::identity( )
+//
+// A Monoid supplies
+//   value_type             --> type of the aggregate
+//   identity( )            --> neutral value
+//   combine( a, b )        --> associative combine, a's items before b's
+//   lift( x )              --> aggregate of the single element x
+
+/**
+ * Sum of the elements.
+ */
+template <typename T>
+struct AvlSum
+{
+    typedef T value_type;
+    static T identity( ) { return T( ); }
+    static T combine( const T & a, const T & b ) { return a + b; }
+    template <typename E>
+    static T lift( const E & x ) { return static_cast<T>( x ); }
+};
+
+/**
+ * Smallest element.
+ */
+template <typename T>
+struct AvlMin
+{
+    typedef T value_type;
+    static T identity( ) { return numeric_limits<T>::max( ); }
+    static T combine( const T & a, const T & b ) { return b < a ? b : a; }
+    template <typename E>
+    static T lift( const E & x ) { return static_cast<T>( x ); }
+};
+
+/**
+ * Largest element.
+ */
+template <typename T>
+struct AvlMax
+{
+    typedef T value_type;
+    static T identity( ) { return numeric_limits<T>::lowest( ); }
+    static T combine( const T & a, const T & b ) { return a < b ? b : a; }
+    template <typename E>
+    static T lift( const E & x ) { return static_cast<T>( x ); }
+};
+
+/**
+ * Number of elements.
+ */
+struct AvlCount
+{
+    typedef int value_type;
+    static int identity( ) { return 0; }
+    static int combine( int a, int b ) { return a + b; }
+    template <typename E>
+    static int lift( const E & ) { return 1; }
+};
+
+/**
+ * Augmentation policy: each node caches the aggregate of its subtree.
+ */
+template <typename Monoid>
+struct AvlMonoidAugment
+{
+    struct data_type
+    {
+        typename Monoid::value_type agg;
+    };
+
+    template <typename Node>
+    static void update( Node *t )
+    {
+        t->agg = Monoid::combine(
+                     Monoid::combine( t->left != NULL ? t->left->agg : Monoid::identity( ),
+                                      Monoid::lift( t->element ) ),
+                     t->right != NULL ? t->right->agg : Monoid::identity( ) );
+    }
+};
+
+template <typename Comparable, typename Monoid>
+class AvlAggregateTree
+{
+    typedef AvlTree<Comparable, AvlMonoidAugment<Monoid> > Tree;
+    typedef typename Tree::Node Node;
+
+  public:
+    typedef typename Monoid::value_type value_type;
+
+    void insert( const Comparable & x )
+    {
+        tree.insert( x );
+    }
+
+    void remove( const Comparable & x )
+    {
+        tree.remove( x );
+    }
+
+    bool contains( const Comparable & x ) const
+    {
+        return tree.contains( x );
+    }
+
+    int size( )
+    {
+        return tree.size( );
+    }
+
+    bool isEmpty( ) const
+    {
+        return tree.isEmpty( );
+    }
+
+    /**
+     * Aggregate over every element.
+     */
+    value_type aggregate( ) const
+    {
+        return agg( tree.getRoot( ) );
+    }
+
+    /**
+     * Aggregate over the elements x with lo <= x <= hi, in sorted order.
+     *  Walks down to the node splitting the range, then down each
+     *  boundary path picking up whole cached subtrees: O( log n ).
+     */
+    value_type aggregate( const Comparable & lo, const Comparable & hi ) const
+    {
+        const Node *t = tree.getRoot( );
+        while( t != NULL && ( t->element < lo || hi < t->element ) )
+            t = ( t->element < lo ) ? t->right : t->left;
+        if( t == NULL )
+            return Monoid::identity( );
+
+        value_type leftPart = Monoid::identity( );
+        for( const Node *n = t->left; n != NULL; )
+        {
+            if( n->element < lo )
+                n = n->right;
+            else
+            {
+                leftPart = Monoid::combine( Monoid::combine( Monoid::lift( n->element ), agg( n->right ) ),
+                                            leftPart );
+                n = n->left;
+            }
+        }
+
+        value_type rightPart = Monoid::identity( );
+        for( const Node *n = t->right; n != NULL; )
+        {
+            if( hi < n->element )
+                n = n->left;
+            else
+            {
+                rightPart = Monoid::combine( rightPart,
+                                             Monoid::combine( agg( n->left ), Monoid::lift( n->element ) ) );
+                n = n->right;
+            }
+        }
+
+        return Monoid::combine( Monoid::combine( leftPart, Monoid::lift( t->element ) ), rightPart );
+    }
+
+  private:
+    Tree tree;
+
+    static value_type agg( const Node *t )
+    {
+        return t == NULL ? Monoid::identity( ) : t->agg;
+    }
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef AVL_INTERVAL_TREE_H
+#define AVL_INTERVAL_TREE_H
+
+#include "AvlTree.h"
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// AvlIntervalTree class
+//
+// CONSTRUCTION: with no parameters
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( lo, hi )   --> Insert closed interval [lo, hi]
+// void remove( lo, hi )   --> Remove interval [lo, hi]
+// bool contains( lo, hi ) --> Return true if [lo, hi] is present
+// int size( )             --> Quantity of intervals in tree
+// boolean isEmpty( )      --> Return true if empty; else false
+// void stab( p, f )       --> Call f( i ) for each interval containing p
+// void overlapping( lo, hi, f ) --> Call f( i ) for each interval meeting [lo, hi]
+// vector stab( p ), overlapping( lo, hi ) --> Same, collected into a vector
+// ******************ERRORS********************************
+// None; queries on an empty tree report nothing
+
+/**
+ * Closed interval [lo, hi], ordered by lo then hi.
+ */
+template <typename T>
+struct AvlInterval
+{
+    T lo;
+    T hi;
+
+    bool overlaps( const T & qlo, const T & qhi ) const
+    {
+        return !( hi < qlo ) && !( qhi < lo );
+    }
+};
+
+template <typename T>
+bool operator<( const AvlInterval<T> & a, const AvlInterval<T> & b )
+{
+    return a.lo < b.lo || ( !( b.lo < a.lo ) && a.hi < b.hi );
+}
+
+template <typename T>
+bool operator==( const AvlInterval<T> & a, const AvlInterval<T> & b )
+{
+    return !( a < b ) && !( b < a );
+}
+
+template <typename T>
+ostream & operator<<( ostream & out, const AvlInterval<T> & i )
+{
+    return out << "[" << i.lo << "," << i.hi << "]";
+}
+
+/**
+ * Augmentation policy: each node tracks the largest hi of its subtree.
+ */
+template <typename T>
+struct AvlIntervalAugment
+{
+    struct data_type
+    {
+        T maxHi;
+    };
+
+    template <typename Node>
+    static void update( Node *t )
+    {
+        t->maxHi = t->element.hi;
+        if( t->left != NULL && t->maxHi < t->left->maxHi )
+            t->maxHi = t->left->maxHi;
+        if( t->right != NULL && t->maxHi < t->right->maxHi )
+            t->maxHi = t->right->maxHi;
+    }
+};
+
+template <typename T>
+class AvlIntervalTree
+{
+    typedef AvlTree<AvlInterval<T>, AvlIntervalAugment<T> > Tree;
+    typedef typename Tree::Node Node;
+
+  public:
+    void insert( const T & lo, const T & hi )
+    {
+        tree.insert( AvlInterval<T>{ lo, hi } );
+    }
+
+    void remove( const T & lo, const T & hi )
+    {
+        tree.remove( AvlInterval<T>{ lo, hi } );
+    }
+
+    bool contains( const T & lo, const T & hi ) const
+    {
+        return tree.contains( AvlInterval<T>{ lo, hi } );
+    }
+
+    int size( )
+    {
+        return tree.size( );
+    }
+
+    bool isEmpty( ) const
+    {
+        return tree.isEmpty( );
+    }
+
+    /**
+     * Call visit( i ) for every interval containing point p, in order.
+     */
+    template <typename Visitor>
+    void stab( const T & p, Visitor && visit ) const
+    {
+        overlapping( p, p, visit );
+    }
+
+    /**
+     * Call visit( i ) for every interval overlapping [lo, hi], in order.
+     *  O( log n + k ) for k reported intervals.
+     */
+    template <typename Visitor>
+    void overlapping( const T & lo, const T & hi, Visitor && visit ) const
+    {
+        overlapping( tree.getRoot( ), lo, hi, visit );
+    }
+
+    vector<AvlInterval<T> > stab( const T & p ) const
+    {
+        return overlapping( p, p );
+    }
+
+    vector<AvlInterval<T> > overlapping( const T & lo, const T & hi ) const
+    {
+        vector<AvlInterval<T> > found;
+        overlapping( lo, hi, [&found]( const AvlInterval<T> & i ) { found.push_back( i ); } );
+        return found;
+    }
+
+  private:
+    Tree tree;
+
+    /**
+     * Internal method to report overlaps in the subtree rooted at t.
+     *  Subtrees whose maxHi falls below lo hold nothing of interest, and
+     *  once an element starts after hi so does its whole right subtree.
+     */
+    template <typename Visitor>
+    void overlapping( const Node *t, const T & lo, const T & hi, Visitor & visit ) const
+    {
+        if( t == NULL || t->maxHi < lo )
+            return;
+        overlapping( t->left, lo, hi, visit );
+        if( hi < t->element.lo )
+            return;
+        if( t->element.overlaps( lo, hi ) )
+            visit( t->element );
+        overlapping( t->right, lo, hi, visit );
+    }
+};
+
+#endif
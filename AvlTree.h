@@ -7,6 +7,8 @@
 #include <vector>
 #include <algorithm> // For max() function
 #include <cmath>
+#include <sstream> // For block buffered printing
+#include <type_traits> // For key trait selection
 using namespace std;
 
 // AvlTree class
@@ -18,7 +20,7 @@ using namespace std;
 // int height( )          --> Height of the tree (null == -1)
 // void insert( x )       --> Insert x
 // void insert( vector<T> ) --> Insert whole vector of values
-// void remove( x )       --> Remove x (unimplemented)
+// void remove( x )       --> Remove x
 // bool contains( x )     --> Return true if x is present
 // Comparable findMin( )  --> Return smallest item
 // Comparable findMax( )  --> Return largest item
@@ -28,24 +30,119 @@ using namespace std;
 // void printPreOrder( )  --> Print tree in pre order
 // void printPostOrder( ) --> Print tree in post order
 // void printInOrder( )   --> Print tree in *in* order
+// void printLevelOrder( ) --> Print tree level by level
+// void inOrder( f )      --> Call f( x ) on each item in sorted order
+// void preOrder( f ), postOrder( f ), levelOrder( f ) --> Same, other orders
+// Iter copyInOrder( it ) --> Write sorted items through an output iterator
+// void inRange( lo, hi, f ) --> Call f( x ) on each lo <= x <= hi, in order
 // ******************ERRORS********************************
 // Throws UnderflowException as warranted
+
+/**
+ * Compile time key properties.
+ *  Small trivially copyable keys (int, long, pointers...) are passed and
+ *  compared by value and take the iterative search path; everything else
+ *  uses const references through the generic code.
+ */
+template <typename Comparable>
+struct AvlKeyTraits
+{
+    static const bool byValue = is_trivially_copyable<Comparable>::value
+                             && sizeof( Comparable ) <= 2 * sizeof( void * );
+    static const bool noThrowCompare = is_scalar<Comparable>::value;
+    typedef typename conditional<byValue, Comparable, const Comparable &>::type param_type;
+    typedef integral_constant<bool, byValue> tag;
+};
+
+/**
+ * Traversal sink that formats items into a local buffer and hands the
+ *  underlying stream one block at a time instead of one item at a time.
+ */
 template <typename Comparable>
-struct AvlNode
+class AvlBlockWriter
+{
+  public:
+    explicit AvlBlockWriter( ostream & theOut, const char * theSep = "  ",
+                             size_t theBlock = 64 * 1024 )
+      : out( theOut ), sep( theSep ), block( theBlock ) { }
+
+    ~AvlBlockWriter( )
+    {
+        flush( );
+    }
+
+    void operator()( const Comparable & x )
+    {
+        buf << x << sep;
+        if( (size_t)buf.tellp( ) >= block )
+            flush( );
+    }
+
+    void flush( )
+    {
+        const string & s = buf.str( );
+        out.write( s.data( ), s.size( ) );
+        buf.str( "" );
+    }
+
+  private:
+    ostream & out;
+    const char * sep;
+    size_t block;
+    ostringstream buf;
+};
+
+/**
+ * Default augmentation policy: no per-node data and nothing to recompute.
+ *
+ *  An augmentation policy supplies
+ *   data_type         --> extra fields mixed into every AvlNode
+ *   update( node )    --> recompute node's fields from its element and
+ *                         children (which are already up to date)
+ *  AvlTree calls update() bottom up whenever a node's subtree changes:
+ *  on the insert/remove path and for both nodes of every rotation.
+ */
+struct AvlNoAugment
 {
+    struct data_type { };
+
+    template <typename Node>
+    static void update( Node * ) { }
+};
+
+/**
+ * Child pointers lead the node so that the element and height share
+ *  the last 8 bytes: an int node packs into 24 bytes on a 64-bit build
+ *  (two per 64 byte line once malloc overhead is added). A long node
+ *  pads out to 32. Augmentation data lives in an (empty by default)
+ *  base class.
+ */
+template <typename Comparable, typename Augment = AvlNoAugment>
+struct AvlNode : public Augment::data_type
+{
+    AvlNode    *left;
+    AvlNode  *right;
     Comparable element;
-    AvlNode <Comparable>    *left;
-    AvlNode  <Comparable>  *right;
     int       height;
 
-    AvlNode( const Comparable & theElement, AvlNode <Comparable>*lt,
-                                            AvlNode <Comparable>*rt, int h = 0 )
-      : element( theElement ), left( lt ), right( rt ), height( h ) { }
+    AvlNode( const Comparable & theElement, AvlNode *lt,
+                                            AvlNode *rt, int h = 0 )
+      : left( lt ), right( rt ), element( theElement ), height( h ) { }
 };
 
-template <typename Comparable>
+static_assert( sizeof( AvlNode<int> ) == 2 * sizeof( void * ) + 2 * sizeof( int ),
+               "int node should pack into two pointers and two ints" );
+
+template <typename Comparable, typename Augment = AvlNoAugment>
 class AvlTree
 {
+  public:
+    typedef AvlNode<Comparable, Augment> Node;
+
+  private:
+    typedef typename AvlKeyTraits<Comparable>::param_type KeyArg;
+    typedef typename AvlKeyTraits<Comparable>::tag KeyTag;
+
   public:
     AvlTree( ) : root( NULL )
       { }
@@ -57,7 +154,6 @@ class AvlTree
 
     ~AvlTree( )
     {
-       cout << " [!] Destructor called." << endl;
        makeEmpty( );
     }
 
@@ -85,20 +181,21 @@ class AvlTree
 
     /**
      * Returns true if x is found in the tree.
+     *  Never throws for scalar keys.
      */
-    bool contains( const Comparable & x ) const
+    bool contains( KeyArg x ) const
+        noexcept( AvlKeyTraits<Comparable>::noThrowCompare )
     {
-        return contains( x, root );
+        return contains( x, root, KeyTag( ) );
     }
 
     /**
      * Test if the tree is logically empty.
      * Return true if empty, false otherwise.
-     *  TODO: Implement
      */
-    bool isEmpty( ) const
+    bool isEmpty( ) const noexcept
     {
-        return false;  // so not correct
+        return root == NULL;
     }
 
     /**
@@ -118,7 +215,12 @@ class AvlTree
       return height( root );
     }
     
-    AvlNode <Comparable> *& getRoot()
+    Node *& getRoot()
+    {
+        return root;
+    }
+
+    const Node * getRoot() const
     {
         return root;
     }
@@ -126,45 +228,125 @@ class AvlTree
     /**
      * Print the tree contents in sorted order.
      */
-    void printTree( ) const
+    void printTree( ostream & out = cout ) const
     {
-        if( isEmpty( ) )
-            cout << "Empty tree" << endl;
-        else
-            printInOrder( root );
+        printInOrder( out );
     }
 
     /**
      * Print the tree contents in sorted order.
      */
-    void printInOrder( ) const
+    void printInOrder( ostream & out = cout ) const
     {
         if( isEmpty( ) )
-            cout << "Empty tree" << endl;
+            out << "Empty tree" << endl;
         else
-            printInOrder( root );
+            inOrder( AvlBlockWriter<Comparable>( out ) );
     }
 
     /**
      * Print the tree contents in pre order.
      */
-    void printPreOrder( ) const
+    void printPreOrder( ostream & out = cout ) const
     {
         if( isEmpty( ) )
-            cout << "Empty tree" << endl;
+            out << "Empty tree" << endl;
         else
-            printPreOrder( root );
+            preOrder( AvlBlockWriter<Comparable>( out ) );
     }
 
     /**
      * Print the tree contents in post order.
      */
-    void printPostOrder( ) const
+    void printPostOrder( ostream & out = cout ) const
     {
         if( isEmpty( ) )
-            cout << "Empty tree" << endl;
+            out << "Empty tree" << endl;
         else
-            printPostOrder( root );
+            postOrder( AvlBlockWriter<Comparable>( out ) );
+    }
+
+    /**
+     * Print the tree contents level by level, top down.
+     */
+    void printLevelOrder( ostream & out = cout ) const
+    {
+        if( isEmpty( ) )
+            out << "Empty tree" << endl;
+        else
+            levelOrder( AvlBlockWriter<Comparable>( out ) );
+    }
+
+    /**
+     * Call visit( x ) for every item in sorted order.
+     *  visit may be any callable taking a const Comparable &; it is
+     *  taken by reference internally so stateful sinks keep their state.
+     */
+    template <typename Visitor>
+    void inOrder( Visitor && visit ) const
+    {
+        inOrder( root, visit );
+    }
+
+    /**
+     * Call visit( x ) for every item in pre order.
+     */
+    template <typename Visitor>
+    void preOrder( Visitor && visit ) const
+    {
+        preOrder( root, visit );
+    }
+
+    /**
+     * Call visit( x ) for every item in post order.
+     */
+    template <typename Visitor>
+    void postOrder( Visitor && visit ) const
+    {
+        postOrder( root, visit );
+    }
+
+    /**
+     * Call visit( x ) for every item level by level, top down.
+     */
+    template <typename Visitor>
+    void levelOrder( Visitor && visit ) const
+    {
+        if( root == NULL )
+            return;
+        queue<Node *> pending;
+        pending.push( root );
+        while( !pending.empty( ) )
+        {
+            Node *t = pending.front( );
+            pending.pop( );
+            visit( t->element );
+            if( t->left != NULL )
+                pending.push( t->left );
+            if( t->right != NULL )
+                pending.push( t->right );
+        }
+    }
+
+    /**
+     * Call visit( x ) for every item with lo <= x <= hi, in sorted order.
+     *  Subtrees wholly outside the range are skipped.
+     */
+    template <typename Visitor>
+    void inRange( const Comparable & lo, const Comparable & hi, Visitor && visit ) const
+    {
+        inRange( root, lo, hi, visit );
+    }
+
+    /**
+     * Write all items in sorted order through an output iterator.
+     *  Returns the iterator one past the last item written.
+     */
+    template <typename OutputIt>
+    OutputIt copyInOrder( OutputIt out ) const
+    {
+        inOrder( [&out]( const Comparable & x ) { *out++ = x; } );
+        return out;
     }
 
     /**
@@ -178,7 +360,7 @@ class AvlTree
     /**
      * Insert x into the tree; duplicates are ignored.
      */
-    void insert( const Comparable & x )
+    void insert( KeyArg x )
     {
         insert( x, root );
     }
@@ -196,9 +378,16 @@ class AvlTree
 
     /**
      * Remove x from the tree. Nothing is done if x is not found.
-     *  TODO: Implement
      */
-    void remove( const Comparable & x , AvlNode <Comparable> *t)
+    void remove( KeyArg x )
+    {
+        remove( x, root );
+    }
+
+    /**
+     * Remove x from the subtree rooted at t. Nothing is done if x is not found.
+     */
+    void remove( const Comparable & x , Node * & t)
     {
         //cout << "[!] Sorry, remove unimplemented; " << x << " still present" << endl;
         if (t==nullptr)
@@ -220,10 +409,14 @@ class AvlTree
         }
         else
         {
-        AvlNode <Comparable> *pMem=t;
+        Node *pMem=t;
         t=(t->left !=nullptr)? t->left :t->right ;
         delete pMem;
         }
+        if (t == nullptr)
+        {
+            return;
+        }
 
         if (height(t->left)-height(t->right) > 1)
         {    
@@ -239,7 +432,7 @@ class AvlTree
            else
            doubleWithRightChild(t);
        }
-       t->height=max(height(t->left),height(t->right))+1;
+       updateNode(t);
      
        
     }
@@ -261,13 +454,13 @@ class AvlTree
   private:
     
 
-    AvlNode <Comparable>*root;
+    Node *root;
 
     /**
      * Internal method to count nodes in tree
      *  TODO: Implement
      */
-    int size( AvlNode <Comparable>* & t )
+    int size( Node * & t )
     {
         if( t == nullptr)
         return(0);
@@ -286,19 +479,19 @@ class AvlTree
      *  TODO: Implement
      */
     
-    void insert( const Comparable & x, AvlNode <Comparable>* & t )
+    void insert( const Comparable & x, Node * & t )
     {
        // Definitely to do
 
        if (t == nullptr)
        {
-           AvlNode <Comparable> *pMem= new AvlNode<Comparable>(x,nullptr,nullptr);
+           Node *pMem= new Node (x,nullptr,nullptr);
            t = pMem;
           
        }
        else if(x< t->element)
        insert (x, t->left);
-       else if (x>t->element)
+       else if (t->element<x)
        insert (x, t->right);
        
         if (height(t->left)-height(t->right) > 1)
@@ -315,7 +508,7 @@ class AvlTree
            else
            doubleWithRightChild(t);
        }
-       t->height=max(height(t->left),height(t->right))+1;
+       updateNode(t);
 
              
     }
@@ -326,7 +519,7 @@ class AvlTree
      *  You'll need this for deletes
      *  TODO: Implement
      */
-    AvlNode <Comparable>* findMin( AvlNode <Comparable>*t ) const
+    Node * findMin( Node *t ) const noexcept
     {
         if(t==nullptr)
         return nullptr;
@@ -344,10 +537,10 @@ class AvlTree
      * Return node containing the largest item.
      *  TODO: Implement
      */
-    AvlNode <Comparable> * findMax( AvlNode<Comparable> *t ) const
+    Node * findMax( Node *t ) const noexcept
     {
         if(t==nullptr)
-        return;
+        return nullptr;
         else 
         {
         while (t->right != NULL) {
@@ -363,21 +556,39 @@ class AvlTree
      * Internal method to test if an item is in a subtree.
      * x is item to search for.
      * t is the node that roots the tree.
-     *  TODO: Implement
+     *  Generic keys: recursive walk through const references.
      */
-    bool contains( const Comparable & x, AvlNode <Comparable>*t ) const
+    bool contains( const Comparable & x, Node *t, false_type ) const
     { 
         if (t == nullptr)
         return false;
         if (t->element == x)
         return true;
         if (t->element < x)
-        return contains(x, t->right);
-        return contains(x, t->left);
+        return contains(x, t->right, false_type( ));
+        return contains(x, t->left, false_type( ));
         
      // Key is smaller than root's key
     }
 
+    /**
+     * Internal method to test if an item is in a subtree.
+     *  By-value keys: iterative walk, child picked with a select
+     *  instead of a branch so the compiler can emit a cmov.
+     */
+    bool contains( Comparable x, Node *t, true_type ) const
+        noexcept( AvlKeyTraits<Comparable>::noThrowCompare )
+    {
+        while (t != nullptr)
+        {
+            const Comparable e = t->element;
+            if (e == x)
+                return true;
+            t = (x < e) ? t->left : t->right;
+        }
+        return false;
+    }
+
 /******************************************************/
 
     /**
@@ -385,82 +596,90 @@ class AvlTree
      *  TODO: implement for destructor
      * 
      */
-    void makeEmpty( AvlNode <Comparable>* & t )
+    void makeEmpty( Node * & t )
     {
         if( t != NULL ) {
             makeEmpty( t->left );
             makeEmpty( t->right );
             delete t;}
-            
+        t = NULL;
     }
 
     /**
-     * Internal method to print a subtree rooted at t in sorted order.
-     *  TODO: Implement
+     * Internal method to visit a subtree rooted at t in sorted order.
      */
-    void printInOrder( AvlNode <Comparable>*t ) const
+    template <typename Visitor>
+    void inOrder( Node *t, Visitor & visit ) const
     {
       if (t == NULL)
       return;
-      printInOrder (t->left);
-      cout<<t->element<<"  ";
-      printInOrder (t->right);
+      inOrder (t->left, visit);
+      visit (t->element);
+      inOrder (t->right, visit);
     }
 
     /**
-     * Internal method to print a subtree rooted at t in pre order.
-     *  TODO: Implement
+     * Internal method to visit items of t's subtree within [lo, hi].
      */
-    void printPreOrder( AvlNode <Comparable>*t ) const
+    template <typename Visitor>
+    void inRange( Node *t, const Comparable & lo, const Comparable & hi, Visitor & visit ) const
     {
       if (t == NULL)
       return;
-      cout<<t->element<<"  ";
-      printPreOrder (t->left);
-      printPreOrder (t->right);
+      if (lo < t->element)
+      inRange (t->left, lo, hi, visit);
+      if (!(t->element < lo) && !(hi < t->element))
+      visit (t->element);
+      if (t->element < hi)
+      inRange (t->right, lo, hi, visit);
     }
 
     /**
-     * Internal method to print a subtree rooted at t in post order.
-     *  TODO: Implement
+     * Internal method to visit a subtree rooted at t in pre order.
      */
-    void printPostOrder( AvlNode <Comparable>*t ) const
+    template <typename Visitor>
+    void preOrder( Node *t, Visitor & visit ) const
     {
       if (t == NULL)
       return;
-      printPostOrder ( t ->left );
-      printPostOrder ( t ->right );
-      cout<<t->element<<"  ";
+      visit (t->element);
+      preOrder (t->left, visit);
+      preOrder (t->right, visit);
+    }
+
+    /**
+     * Internal method to visit a subtree rooted at t in post order.
+     */
+    template <typename Visitor>
+    void postOrder( Node *t, Visitor & visit ) const
+    {
+      if (t == NULL)
+      return;
+      postOrder ( t ->left, visit );
+      postOrder ( t ->right, visit );
+      visit (t->element);
     }
 
     /**
      * Internal method to clone subtree.
      */
-    AvlNode <Comparable>* clone( AvlNode <Comparable>*t ) const
+    Node * clone( Node *t ) const
     {
         if( t == NULL )
             return NULL;
         else
-            return new AvlNode<Comparable> ( t->element, clone( t->left ), clone( t->right ), t->height );
+            return new Node ( t->element, clone( t->left ), clone( t->right ), t->height );
     }
 
 
     // Avl manipulations
     /**
      * Return the height of node t or -1 if NULL.
-     *  TODO: Implement
+     *  Heights are cached in the nodes, so this is O(1).
      */
-    int height( AvlNode <Comparable>*t ) const
+    int height( Node *t ) const noexcept
     {
-        if (t == nullptr)
-        return -1;
-    
-        int leftTree= height(t->left);
-        int rightTree = height(t->right);
-        if (leftTree > rightTree) 
-            return leftTree + 1;
-        else 
-            return rightTree + 1;
+        return t == nullptr ? -1 : t->height;
     }
 
 
@@ -469,19 +688,28 @@ class AvlTree
         return lhs > rhs ? lhs : rhs;
     }
 
+    /**
+     * Recompute t's height and augmentation data from its children.
+     */
+    void updateNode( Node *t )
+    {
+        t->height=max(height(t->left), height(t->right))+1;
+        Augment::update(t);
+    }
+
     /**
      * Rotate binary tree node with left child.
      * For AVL trees, this is a single rotation for case 1.
      * Update heights, then set new root.
      *  TODO: Implement
      */
-    void rotateWithLeftChild( AvlNode <Comparable>* & k2 )
+    void rotateWithLeftChild( Node * & k2 )
     {
-        AvlNode <Comparable> *temp=k2->left;
+        Node *temp=k2->left;
         k2->left=temp->right;
         temp->right= k2;
-        k2->height=max(height(k2->left), height(k2->right))+1;
-        temp->height=max(height(temp->left), height(k2))+1;
+        updateNode(k2);
+        updateNode(temp);
         k2=temp;
 
     }
@@ -493,13 +721,13 @@ class AvlTree
      *  TODO: Implement
      */
 
-    void rotateWithRightChild( AvlNode <Comparable>* & k1 )
+    void rotateWithRightChild( Node * & k1 )
     {
-        AvlNode <Comparable> *temp=k1->right;
+        Node *temp=k1->right;
         k1->right=temp->left;
         temp->left=k1;
-        k1->height=max(height(k1->right), height(k1->left))+1;
-        temp->height=max(height(temp->right), height(k1))+1;
+        updateNode(k1);
+        updateNode(temp);
         k1=temp;
     }
 
@@ -511,7 +739,7 @@ class AvlTree
      *  TODO: Implement
      * right left rotation
      */
-    void doubleWithLeftChild( AvlNode <Comparable>* & k3 )
+    void doubleWithLeftChild( Node * & k3 )
     {
         rotateWithRightChild(k3->left);
         rotateWithLeftChild(k3);
@@ -524,9 +752,9 @@ class AvlTree
      * Update heights, then set new root.
      *  TODO: Implement
      */
-    void doubleWithRightChild( AvlNode <Comparable>* & k1 )
+    void doubleWithRightChild( Node * & k1 )
     {
-        rotateWithLeftChild(k1->left);
+        rotateWithLeftChild(k1->right);
         rotateWithRightChild(k1);
     }
 };
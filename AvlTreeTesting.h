@@ -5,8 +5,14 @@
 
 
 #include "AvlTree.h"
+#include "AvlIntervalTree.h"
+#include "AvlAggregateTree.h"
+#include "ShardedAvlTree.h"
+#include <thread>
 #include <iostream>
 #include <string.h>
+#include <sstream>
+#include <iterator>
 
 
 /*****************************************************************************/
@@ -102,6 +108,22 @@ void test_prints() {
     cout << "   [t] Post Order:\t";
     myTree.printPostOrder();
     cout << endl;
+
+    cout << "   [t] Level Order:\t";
+    myTree.printLevelOrder();
+    cout << endl;
+
+    ostringstream sink;
+    myTree.printInOrder( sink );
+    cout << "   [t] In Order to a stream";
+    (sink.str() == "1  3  5  7  10  23  30  ") ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+
+    vector<int> sorted;
+    myTree.copyInOrder( back_inserter( sorted ) );
+    cout << "   [t] In Order through an output iterator";
+    (sorted == vector<int>{ 1, 3, 5, 7, 10, 23, 30 }) ? cout << " - pass" : cout << " - fail";
+    cout << endl;
 }
 
 
@@ -151,6 +173,28 @@ void test_contains() {
     (!myTree.contains(15)) ? cout << " - pass" : cout << " - fail"; cout << endl;
 }
 
+/**
+ *  Testing findMin()/findMax() and the generic (non by-value) key path
+ */
+void test_minmax() {
+    AvlTree<long> myTree;
+    vector<long> vals = { 10, 5, 23, 3, 7, 30, 1 };   // Give us some data!
+    myTree.insert( vals );
+    cout << "  [t] Testing findMin()/findMax():" << endl;
+    cout << "   [t] Min (1): " << myTree.findMin();
+    (myTree.findMin() == 1) ? cout << " - pass" : cout << " - fail"; cout << endl;
+    cout << "   [t] Max (30): " << myTree.findMax();
+    (myTree.findMax() == 30) ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    AvlTree<string> strTree;
+    strTree.insert( "pear" );
+    strTree.insert( "apple" );
+    strTree.insert( "zucchini" );
+    cout << "   [t] String tree contains apple, not kiwi";
+    (strTree.contains("apple") && !strTree.contains("kiwi")) ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+}
+
 /**
  *  Testing the remove() function
  */
@@ -169,6 +213,167 @@ void test_remove() {
 
 }
 
+/**
+ *  Testing interval stabbing/overlap queries against a linear scan
+ *   Inserts and removals force rotations, so this also checks that the
+ *   subtree maxHi augmentation survives rebalancing.
+ */
+void test_intervals() {
+    AvlIntervalTree<int> ivTree;
+    vector<AvlInterval<int> > all;
+    cout << "  [t] Testing interval tree queries:" << endl;
+    for( int i = 0; i < 500; i++ ) {
+        int lo = (i * 7919) % 1000;
+        int hi = lo + (i * 31) % 50;
+        ivTree.insert( lo, hi );
+        all.push_back( AvlInterval<int>{ lo, hi } );
+    }
+    for( int i = 0; i < 500; i += 3 ) {
+        ivTree.remove( all[i].lo, all[i].hi );
+        all[i].lo = -1;  all[i].hi = -1;
+    }
+    bool ok = true;
+    for( int q = 0; q < 1050 && ok; q += 7 ) {
+        int expected = 0;
+        for( size_t i = 0; i < all.size(); i++ )
+            if( all[i].lo >= 0 && all[i].overlaps( q, q + 5 ) )
+                expected++;
+        int found = 0;
+        ivTree.overlapping( q, q + 5, [&found]( const AvlInterval<int> & ) { found++; } );
+        ok = (found == expected);
+    }
+    cout << "   [t] Overlap queries match a linear scan";
+    ok ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    AvlIntervalTree<int> small;
+    small.insert( 1, 5 );
+    small.insert( 4, 9 );
+    small.insert( 10, 12 );
+    vector<AvlInterval<int> > hits = small.stab( 4 );
+    cout << "   [t] Stab 4 finds [1,5] and [4,9]";
+    (hits.size() == 2 && hits[0].lo == 1 && hits[1].lo == 4) ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+}
+
+/**
+ *  Testing range aggregates (sum, min, max, count) against a linear scan
+ */
+void test_aggregates() {
+    AvlAggregateTree<int, AvlSum<long> > sums;
+    AvlAggregateTree<int, AvlMin<int> > mins;
+    AvlAggregateTree<int, AvlMax<int> > maxes;
+    AvlAggregateTree<int, AvlCount> counts;
+    vector<int> vals;
+    cout << "  [t] Testing range aggregates:" << endl;
+    for( int i = 0; i < 400; i++ ) {
+        int v = (i * 7919) % 2000;
+        sums.insert( v );  mins.insert( v );  maxes.insert( v );  counts.insert( v );
+        vals.push_back( v );
+    }
+    for( int i = 0; i < 400; i += 4 ) {
+        sums.remove( vals[i] );  mins.remove( vals[i] );
+        maxes.remove( vals[i] );  counts.remove( vals[i] );
+        vals[i] = -1;
+    }
+    bool ok = true;
+    for( int lo = -50; lo < 2050 && ok; lo += 37 ) {
+        int hi = lo + 150;
+        long sum = 0;
+        int mn = numeric_limits<int>::max(), mx = numeric_limits<int>::lowest(), cnt = 0;
+        for( size_t i = 0; i < vals.size(); i++ ) {
+            if( vals[i] >= 0 && vals[i] >= lo && vals[i] <= hi ) {
+                sum += vals[i];  cnt++;
+                mn = min( mn, vals[i] );  mx = std::max( mx, vals[i] );
+            }
+        }
+        ok = sums.aggregate( lo, hi ) == sum && mins.aggregate( lo, hi ) == mn
+          && maxes.aggregate( lo, hi ) == mx && counts.aggregate( lo, hi ) == cnt;
+    }
+    cout << "   [t] Range sum/min/max/count match a linear scan";
+    ok ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    cout << "   [t] Whole tree count (300): " << counts.aggregate();
+    (counts.aggregate() == 300) ? cout << " - pass" : cout << " - fail"; cout << endl;
+}
+
+/**
+ *  Testing the range-sharded tree with concurrent writers
+ *   A small split size forces many splits while threads are inserting.
+ */
+void test_sharded() {
+    ShardedAvlTree<int> sharded( vector<int>{ 25000, 50000, 75000 }, 500 );
+    cout << "  [t] Testing sharded tree:" << endl;
+
+    vector<thread> writers;
+    for( int w = 0; w < 4; w++ ) {
+        writers.push_back( thread( [&sharded, w]() {
+            for( int i = w; i < 100000; i += 4 )
+                if( i % 5 != 0 )
+                    sharded.insert( (i * 7919) % 100000 );
+        } ) );
+    }
+    for( size_t w = 0; w < writers.size(); w++ )
+        writers[w].join();
+
+    cout << "   [t] Size after concurrent inserts (80000): " << sharded.size();
+    (sharded.size() == 80000) ? cout << " - pass" : cout << " - fail"; cout << endl;
+    cout << "   [t] Shards split from 4 to " << sharded.shardCount();
+    (sharded.shardCount() > 4) ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    bool sorted = true;
+    int seen = 0, prev = -1;
+    sharded.inOrder( [&]( int x ) { sorted = sorted && prev < x; prev = x; seen++; } );
+    cout << "   [t] Cross-shard iteration is ordered and complete";
+    (sorted && seen == 80000) ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    int inRange = 0;
+    sharded.inRange( 24990, 50010, [&inRange]( int ) { inRange++; } );
+    int expected = 0;
+    for( int v = 24990; v <= 50010; v++ )
+        if( sharded.contains( v ) )
+            expected++;
+    cout << "   [t] Range query across shard boundaries";
+    (inRange == expected && inRange > 0) ? cout << " - pass" : cout << " - fail"; cout << endl;
+
+    int before = sharded.shardCount();
+    for( int v = 0; v < 100000; v++ )
+        if( v % 10 != 1 )
+            sharded.remove( v );
+    cout << "   [t] Removals merge shards (" << before << " -> " << sharded.shardCount() << ")";
+    (sharded.shardCount() < before && !sharded.contains( 12 ) && sharded.contains( 11 ))
+        ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+
+    // Hovering around the split size splits and merges over and over
+    ShardedAvlTree<int> churn( vector<int>( ), 64 );
+    for( int round = 0; round < 300; round++ ) {
+        for( int v = 0; v < 80; v++ )
+            churn.insert( v );
+        for( int v = 0; v < 80; v++ )
+            churn.remove( v );
+    }
+    cout << "   [t] Retired directories freed under churn (" << churn.retiredCount() << " left)";
+    (churn.retiredCount() <= 2 && churn.size() == 0) ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+
+    // A small shard only merges once it and a neighbour fit in half a
+    //  split; the constructor's boundary is never merged away
+    ShardedAvlTree<int> halves( vector<int>{ 1000 }, 64 );
+    for( int v = 0; v < 65; v++ )
+        halves.insert( v );
+    int split = halves.shardCount();
+    for( int v = 0; v < 20; v++ )
+        halves.remove( v );
+    int kept = halves.shardCount();
+    for( int v = 20; v < 50; v++ )
+        halves.remove( v );
+    cout << "   [t] Merges wait for half a split, keep chosen boundaries ("
+         << split << " -> " << kept << " -> " << halves.shardCount() << ")";
+    (split == 3 && kept == 3 && halves.shardCount() == 2 && halves.size() == 15)
+        ? cout << " - pass" : cout << " - fail";
+    cout << endl;
+}
+
 
 /*
  *  Testing features of your AVL Tree implementation
@@ -182,7 +387,11 @@ int avlTreeTests( bool fuzzing )
     test_prints();           // Print: preorder, postorder, inorder, levelorder
     test_insert();           // Insert test
     test_contains();         // Testing contains interface
+    test_minmax();           // findMin()/findMax() and string keys
     test_remove();           // Test of removing nodes via remove()
+    test_intervals();        // Interval tree built on the augmentation hooks
+    test_aggregates();       // Range sum/min/max/count on the augmentation hooks
+    test_sharded();          // Range-sharded tree under concurrent writers
     if( fuzzing ) test_BigTreeFuzzing();   //Big tree fuzzing test
 
     return(0);
@@ -0,0 +1,358 @@
+/**
+ *  benchmarks.h - Timing and distribution checks for the hash table
+ *   Run with: ./HashingDict --bench   (or make bench)
+ *
+ */
+
+#ifndef __BENCHMARKS_H
+#define __BENCHMARKS_H
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include "hashtable.h"
+#include "concurrenthashtable.h"
+#include "rcuhashtable.h"
+#include "spellindex.h"
+#include "word.h"
+
+using namespace std;
+
+/**
+ *  Pull every "word": "..." value out of a dictionary JSON file
+ */
+void bench_read_words( string filename, vector<string> & words ) {
+	ifstream in( filename );
+	string line;
+	const string tag = "\"word\": \"";
+	while( getline( in, line ) ) {
+		size_t at = line.find( tag );
+		if( at == string::npos )
+			continue;
+		at += tag.size();
+		size_t end = line.find( '"', at );
+		if( end != string::npos )
+			words.push_back( line.substr( at, end - at ) );
+	}
+}
+
+/**
+ *  Drop keys into buckets with one hash and sizing policy and print
+ *   how long the buckets get. A good hash looks Poisson for the load
+ *   (at 0.5: about 61% empty, 30% one key, 8% two, 1% three).
+ */
+template <typename HASH, typename SIZING>
+void bench_bucket_lengths( string label, const vector<string> & keys, const HASH & hasher ) {
+	int buckets = SIZING::size_for( keys.size() * 2 );
+	typename SIZING::Reducer reduce( buckets );
+	vector<int> lengths( buckets, 0 );
+	for( const string & key : keys )
+		lengths[reduce.bucket( (uint32_t)hasher( key ) )]++;
+
+	int longest = 0;
+	vector<int> histogram( 5, 0 );          // 0, 1, 2, 3, 4+
+	for( int len : lengths ) {
+		longest = max( longest, len );
+		histogram[min( len, 4 )]++;
+	}
+	cout << "   " << left << setw( 28 ) << label << right;
+	for( int count : histogram )
+		cout << setw( 7 ) << fixed << setprecision( 1 ) << 100.0 * count / buckets << "%";
+	cout << "   longest " << longest << endl;
+}
+
+/**
+ *  Nanoseconds per key for one hash
+ */
+template <typename HASH>
+double bench_hash_speed( const vector<string> & keys, const HASH & hasher ) {
+	const int rounds = 50;
+	uint64_t sink = 0;
+	auto start = chrono::steady_clock::now();
+	for( int r = 0; r < rounds; r++ )
+		for( const string & key : keys )
+			sink += hasher( key );
+	auto stop = chrono::steady_clock::now();
+	volatile uint64_t keep = sink;
+	(void)keep;
+	return chrono::duration<double, nano>( stop - start ).count() / ( (double)rounds * keys.size() );
+}
+
+/**
+ *  Compare the old polynomial hash against the seeded default on one key set
+ */
+void bench_compare_hashes( string title, const vector<string> & keys ) {
+	PolynomialHash poly;
+	SeededHash seeded( fresh_hash_seed() );
+
+	cout << " [b] " << title << " (" << keys.size() << " keys, " << PrimeSizing::size_for( keys.size() * 2 )
+	     << " / " << PowerOfTwoSizing::size_for( keys.size() * 2 ) << " buckets)" << endl;
+	cout << "   " << left << setw( 28 ) << "bucket length:" << right
+	     << "      0       1       2       3      4+" << endl;
+	bench_bucket_lengths<PolynomialHash, PrimeSizing>( "polynomial / prime", keys, poly );
+	bench_bucket_lengths<SeededHash, PrimeSizing>( "seeded / prime", keys, seeded );
+	bench_bucket_lengths<PolynomialHash, PowerOfTwoSizing>( "polynomial / power of two", keys, poly );
+	bench_bucket_lengths<SeededHash, PowerOfTwoSizing>( "seeded / power of two", keys, seeded );
+	cout << "   ns per key: polynomial " << setprecision( 2 ) << bench_hash_speed( keys, poly )
+	     << ", seeded " << bench_hash_speed( keys, seeded ) << endl << endl;
+}
+
+/**
+ *  Lookup throughput of a thread-safe table as reader threads are added
+ *   One extra thread keeps inserting new keys the whole time
+ */
+template <typename TABLE>
+void bench_read_scaling( string title, TABLE & shared ) {
+	const int numKeys = 200000, lookupsPerThread = 400000;
+	vector<string> keys;
+	for( int i = 0; i < numKeys; i++ ) {
+		keys.push_back( "GRUGRU WORM " + to_string( i ) );
+		shared.emplace( keys.back(), "isa word" );
+	}
+
+	cout << " [b] " << title << " read scaling (" << numKeys << " keys, one concurrent writer, "
+	     << thread::hardware_concurrency() << " cores)" << endl;
+	for( int readers = 1; readers <= 8; readers *= 2 ) {
+		atomic<bool> writing( true );
+		thread writer( [&shared, &writing]() {
+			for( int i = 0; writing; i++ )
+				shared.emplace( "LOADER " + to_string( i ), "isa word" );
+		} );
+
+		atomic<long> hits( 0 );
+		vector<thread> threads;
+		auto start = chrono::steady_clock::now();
+		for( int r = 0; r < readers; r++ ) {
+			threads.emplace_back( [&, r]() {
+				long found = 0;
+				unsigned int x = 12345 + r;
+				for( int i = 0; i < lookupsPerThread; i++ ) {
+					x = x * 1103515245u + 12345u;
+					found += shared.visit( keys[x % numKeys], []( const Word & ) { } );
+				}
+				hits += found;
+			} );
+		}
+		for( thread & t : threads )
+			t.join();
+		auto stop = chrono::steady_clock::now();
+		writing = false;
+		writer.join();
+
+		double seconds = chrono::duration<double>( stop - start ).count();
+		cout << "   " << readers << " reader(s): " << fixed << setprecision( 2 )
+		     << readers * (double)lookupsPerThread / seconds / 1e6 << " M lookups/s"
+		     << ( hits == (long)readers * lookupsPerThread ? "" : " (missed keys!)" ) << endl;
+	}
+	cout << endl;
+}
+
+/**
+ *  Throughput of the JSON loader on a synthetic dictionary, parsing
+ *   alone and parsing into a table
+ */
+void bench_json_load() {
+	string json = "{\n  \"dictionary\": [\n";
+	for( int i = 0; i < 200000; i++ ) {
+		json += "    {\"word\": \"GRUGRU WORM " + to_string( i ) + "\", \"definition\": \"The larva or grub of a large"
+		        " South American beetle (Calandra palmarum), which lives in the pith of palm trees.\"},\n";
+	}
+	json += "    {\"word\": \"DEWLAPPED\", \"definition\": \"Furnished with a dewlap.\"}\n  ]\n}\n";
+	double megabytes = json.size() / 1e6;
+
+	auto start = chrono::steady_clock::now();
+	size_t entries = 0;
+	DictJsonParser( json ).for_each_entry( [&entries]( string_view, string_view ) { entries++; } );
+	double parseSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+	start = chrono::steady_clock::now();
+	Hashtable<string, Word> table;
+	DictJsonParser( json ).for_each_entry( [&table]( string_view word, string_view def ) { table.emplace( word, def ); } );
+	double loadSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+	cout << " [b] JSON loader (" << entries << " entries, " << fixed << setprecision( 1 ) << megabytes << " MB)" << endl;
+	cout << "   parse only:   " << megabytes / parseSeconds << " MB/s" << endl;
+	cout << "   parse+insert: " << megabytes / loadSeconds << " MB/s" << endl;
+
+	// The same table written out and mapped back in as a snapshot
+	const char * snapPath = "bench_tmp.snap";
+	table.save( snapPath );
+	start = chrono::steady_clock::now();
+	Hashtable<string, Word> mapped;
+	mapped.load( snapPath );
+	bool hit = mapped.contains( "GRUGRU WORM 4242" );
+	double snapSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	std::remove( snapPath );
+	cout << "   snapshot open + first lookup: " << setprecision( 3 ) << snapSeconds * 1e3 << " ms"
+	     << ( hit ? "" : " (lookup failed!)" ) << " vs " << loadSeconds * 1e3 << " ms from JSON" << endl;
+	cout << setprecision( 1 );
+
+	// Parts parsed on their own threads, and loaded into per-thread tables
+	const char * jsonPath = "bench_tmp.json";
+	{
+		ofstream out( jsonPath );
+		out << json;
+	}
+	for( int threads = 2; threads <= 8; threads *= 2 ) {
+		start = chrono::steady_clock::now();
+		int parts;
+		size_t errorAt;
+		for_each_dict_part( json, threads, []( int, string_view, string_view ) { }, parts, errorAt, 1 << 16 );
+		double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+		cout << "   parse only, " << threads << " threads: " << megabytes / seconds << " MB/s" << endl;
+		start = chrono::steady_clock::now();
+		Hashtable<string, Word> loaded;
+		loaded.load( jsonPath, threads );
+		seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+		cout << "   file load,  " << threads << " threads: " << megabytes / seconds << " MB/s" << endl;
+	}
+	std::remove( jsonPath );
+	cout << endl;
+}
+
+/**
+ *  Spelling suggestions: index build, memory, and suggestions per second
+ *   for misspellings one and two edits away, against scanning every word
+ */
+void bench_spelling() {
+	const int numWords = 100000, numQueries = 20000;
+	unsigned int x = 7;
+	auto next = [&x]() { x = x * 1103515245u + 12345u; return x >> 16; };
+	vector<string> words;
+	for( int i = 0; i < numWords; i++ ) {
+		string w( 4 + next() % 9, 'A' );
+		for( char & c : w )
+			c = 'A' + next() % 26;
+		words.push_back( w );
+	}
+	vector<string> queries;
+	for( int i = 0; i < numQueries; i++ ) {
+		string q = words[next() % numWords];
+		q[next() % q.size()] = 'A' + next() % 26;
+		if( i % 2 )
+			q.erase( next() % q.size(), 1 );
+		queries.push_back( q );
+	}
+
+	cout << " [b] Spelling suggestions (" << numWords << " words, distance 2)" << endl;
+	for( int prefix : { 5, 7 } ) {
+		SpellIndex index( 2, prefix );
+		auto start = chrono::steady_clock::now();
+		index.assign( vector<string_view>( words.begin(), words.end() ) );
+		double buildSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+		vector<string> out;
+		size_t found = 0;
+		start = chrono::steady_clock::now();
+		for( const string & q : queries )
+			found += index.suggest( q, 5, out, []( string_view ) { return true; } );
+		double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+		cout << "   prefix " << prefix << ": build " << fixed << setprecision( 2 ) << buildSeconds << " s, "
+		     << index.index_bytes() / 1e6 << " MB, " << setprecision( 0 ) << numQueries / seconds
+		     << " suggestions/s (" << found << " found)" << endl;
+	}
+
+	// The scan compares every word, so a few queries are enough
+	const int scanQueries = 50;
+	auto start = chrono::steady_clock::now();
+	size_t close = 0;
+	for( int i = 0; i < scanQueries; i++ )
+		for( const string & w : words )
+			close += edit_distance( queries[i], w, 2 ) <= 2;
+	double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	cout << "   full scan:  " << setprecision( 0 ) << scanQueries / seconds << " suggestions/s" << endl << endl;
+	cout << setprecision( 1 );
+}
+
+/**
+ *  Random word draws per second, as the random command makes them
+ */
+void bench_random_words() {
+	const int numKeys = 200000, draws = 2000000;
+	Hashtable<string, Word> table;
+	for( int i = 0; i < numKeys; i++ )
+		table.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+	for( int i = 0; i < numKeys; i += 3 )
+		table.remove( "GRUGRU WORM " + to_string( i ) );
+
+	size_t length = 0;
+	auto start = chrono::steady_clock::now();
+	for( int i = 0; i < draws; i++ )
+		length += table.random_entry()->myword.size();
+	double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	cout << " [b] Random words (" << table.size() << " entries): " << fixed << setprecision( 1 )
+	     << draws / seconds / 1e6 << " M draws/s" << ( length > 0 ? "" : "!" ) << endl << endl;
+}
+
+/**
+ *  Printing every word: a line and a flush at a time against print()'s
+ *   block writes, into /dev/null so only the output path is timed
+ */
+void bench_print_words() {
+	const int numKeys = 500000;
+	Hashtable<string, Word> table;
+	for( int i = 0; i < numKeys; i++ )
+		table.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+	ofstream sink( "/dev/null" );
+
+	auto start = chrono::steady_clock::now();
+	table.for_each( [&sink]( const Word & w ) { sink << w.myword << endl; } );
+	double perLine = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	start = chrono::steady_clock::now();
+	table.print( 0, sink );
+	double blocks = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+	start = chrono::steady_clock::now();
+	for( int i = 0; i < 1000; i++ )
+		table.print( 10, sink );
+	double firstTen = chrono::duration<double>( chrono::steady_clock::now() - start ).count() / 1000;
+	cout << " [b] Printing " << numKeys << " words:" << endl << fixed << setprecision( 1 );
+	cout << "   endl per line: " << perLine * 1e3 << " ms" << endl;
+	cout << "   block writes:  " << blocks * 1e3 << " ms" << endl;
+	cout << "   print 10:      " << setprecision( 2 ) << firstTen * 1e6 << " us" << endl << endl;
+	cout << setprecision( 1 );
+}
+
+/**
+ *  Benchmark mode operations
+ */
+void run_benchmarks() {
+	cout << " [b] Running benchmarks. " << endl << endl;
+
+	vector<string> dictWords;
+	bench_read_words( "config/dictLoad1.json", dictWords );
+	bench_read_words( "config/dictLoad2.json", dictWords );
+	bench_read_words( "config/dictUnload1.json", dictWords );
+	if( dictWords.empty() )
+		cout << " [b] No dictionary words found; run from the Dictionary-for-Hashing directory" << endl;
+	else
+		bench_compare_hashes( "Dictionary JSON words", dictWords );
+
+	// Short keys differing only in their last characters
+	vector<string> serial;
+	for( int i = 0; i < 100000; i++ )
+		serial.push_back( "W" + to_string( i ) );
+	bench_compare_hashes( "Serial keys W0..W99999", serial );
+
+	// Long multi-word keys sharing a prefix
+	vector<string> phrases;
+	for( int i = 0; i < 100000; i++ )
+		phrases.push_back( "GRUGRU WORM VARIETY " + to_string( i * 7919 ) );
+	bench_compare_hashes( "Long phrase keys", phrases );
+
+	bench_json_load();
+	bench_spelling();
+	bench_random_words();
+	bench_print_words();
+
+	ConcurrentHashtable<string, Word> sharded( 16, 200000 );
+	bench_read_scaling( "Sharded table (16 shards)", sharded );
+	RcuHashtable<string, Word> lockFree( 200000 );
+	bench_read_scaling( "Lock-free read table", lockFree );
+}
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ *  Sharded hash table for many concurrent readers and writers
+ *
+ */
+
+#ifndef __CONCURRENT_HASH_H
+#define __CONCURRENT_HASH_H
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "hashtable.h"
+
+using namespace std;
+/*
+	public:
+		bool insert(LOOKUP key, VALTYPE val);     // val is moved in
+		bool emplace(ARGS... args);               // Build the VALTYPE in place
+		bool contains(LOOKUP key);
+		int remove(LOOKUP key);
+		bool find(LOOKUP key, OwnedEntry<VALTYPE> & out);  // Copy out the entry and its text
+		bool visit(LOOKUP key, FUNC f);           // f(const VALTYPE &) under the shard lock
+		int size();            // Elements over all shards
+		bool empty();
+		float load_factor();   // Elements per bucket over all shards
+		void clear();
+		int bucket_count();    // Buckets over all shards
+		int shard_count();
+		void load(string filename, int threads);  // Add a dictionary JSON file
+*/
+
+/*
+ *  Keys are spread over a power-of-two number of shards, each a plain
+ *  Hashtable behind its own reader/writer lock. Readers of one shard
+ *  share it; a writer only blocks the one shard its key lands in, and
+ *  every shard grows on its own, so a loader filling the table never
+ *  stalls lookups elsewhere.
+ *
+ *  The shard comes from bits 32 and up of a multiplicative mix of the
+ *  key's hash, which the shard's table does not use for its bucket or
+ *  fingerprint. All shards share one seed.
+ *
+ *  Pointers into a shard, and the text its entries view, are only good
+ *  while its lock is held, so find() copies the entry and its text into
+ *  an OwnedEntry; visit() hands it to a callback under the read lock
+ *  instead.
+ */
+template <typename KEYTYPE, typename VALTYPE, typename HASH = SeededHash,
+          typename SIZING = PrimeSizing>
+class ConcurrentHashtable
+{
+	public:
+		typedef Hashtable<KEYTYPE, VALTYPE, HASH, SIZING> TABLE;
+		typedef typename TABLE::LOOKUP LOOKUP;
+
+	private:
+		// One cache line per shard so neighbouring locks do not false-share
+		struct alignas(64) Shard
+		{
+			shared_mutex lock;
+			TABLE table;
+		};
+
+		HASH hasher;
+		int shardBits;
+		unique_ptr<Shard[]> shards;
+
+		uint32_t shard_index(LOOKUP key)
+		{
+			uint64_t mixed = hasher(key) * 0x9E3779B97F4A7C15ull;
+			return (mixed >> 32) & ((1u << shardBits) - 1);
+		}
+
+		Shard & shard_for(LOOKUP key)
+		{
+			return shards[shard_index(key)];
+		}
+
+	public:
+		/**
+		 *  Basic constructor
+		 *   numShards is rounded up to a power of two; startingSize is
+		 *   split evenly between them
+		 */
+		ConcurrentHashtable( int numShards = 16, int startingSize = 101,
+		                     uint64_t seed = fresh_hash_seed() )
+		  : hasher(seed), shardBits(0)
+		{
+			while((1 << shardBits) < numShards && shardBits < 16)
+				shardBits++;
+			shards.reset(new Shard[1 << shardBits]);
+			for(int i = 0; i < shard_count(); i++)
+				shards[i].table = TABLE(startingSize / shard_count() + 1, seed);
+		}
+
+		ConcurrentHashtable( const ConcurrentHashtable & ) = delete;
+		ConcurrentHashtable & operator=( const ConcurrentHashtable & ) = delete;
+
+		/**
+		 *  Add an element, replacing any existing entry for key
+		 */
+		bool insert(LOOKUP key, VALTYPE val) {
+			Shard & s = shard_for(key);
+			unique_lock<shared_mutex> held(s.lock);
+			return s.table.insert(key, std::move(val));
+		}
+
+		/**
+		 *  Build a VALTYPE from args and insert it under its own myword
+		 *   Built before locking so the lock only covers the insert
+		 */
+		template <typename... ARGS>
+		bool emplace(ARGS &&... args) {
+			VALTYPE val(std::forward<ARGS>(args)...);
+			Shard & s = shard_for(val.myword);
+			unique_lock<shared_mutex> held(s.lock);
+			return s.table.emplace(std::move(val));
+		}
+
+		bool contains(LOOKUP key) {
+			Shard & s = shard_for(key);
+			shared_lock<shared_mutex> held(s.lock);
+			return s.table.contains(key);
+		}
+
+		/**
+		 *  Remove key; returns number of elements removed
+		 */
+		int remove(LOOKUP key) {
+			Shard & s = shard_for(key);
+			unique_lock<shared_mutex> held(s.lock);
+			return s.table.remove(key);
+		}
+
+		/**
+		 *  Copy the entry for key, text and all, into out while read locked
+		 *   Returns false, leaving out alone, if key is absent
+		 */
+		bool find(LOOKUP key, OwnedEntry<VALTYPE> & out) {
+			return visit(key, [&out](const VALTYPE & found) { out.assign(found); });
+		}
+
+		/**
+		 *  Call f(entry) for key's entry while its shard is read locked
+		 *   f must not call back into this table
+		 */
+		template <typename FUNC>
+		bool visit(LOOKUP key, FUNC && f) {
+			Shard & s = shard_for(key);
+			shared_lock<shared_mutex> held(s.lock);
+			VALTYPE found;
+			if(!s.table.find(key, found))   // Never thaws, so fine under a read lock
+				return false;
+			f(found);
+			return true;
+		}
+
+		/**
+		 *  Elements over all shards; shards are counted one at a time,
+		 *   so concurrent writers make this approximate
+		 */
+		int size() {
+			int total = 0;
+			for(int i = 0; i < shard_count(); i++) {
+				shared_lock<shared_mutex> held(shards[i].lock);
+				total += shards[i].table.size();
+			}
+			return total;
+		}
+
+		bool empty() {
+			return size() == 0;
+		}
+
+		int bucket_count() {
+			int total = 0;
+			for(int i = 0; i < shard_count(); i++) {
+				shared_lock<shared_mutex> held(shards[i].lock);
+				total += shards[i].table.bucket_count();
+			}
+			return total;
+		}
+
+		float load_factor() {
+			return (float)size() / (float)bucket_count();
+		}
+
+		void clear() {
+			for(int i = 0; i < shard_count(); i++) {
+				unique_lock<shared_mutex> held(shards[i].lock);
+				shards[i].table.clear();
+			}
+		}
+
+		int shard_count() {
+			return 1 << shardBits;
+		}
+
+		/**
+		 *  Add every entry of a dictionary JSON file using up to threads
+		 *   threads
+		 *   The file is parsed into a list of entries, which threads then
+		 *   share out by shard: thread w inserts, in file order, only the
+		 *   entries whose shard is w modulo threads. No two loaders touch
+		 *   the same shard, and each shard sees its keys in file order, so
+		 *   later duplicates win exactly as in a sequential load.
+		 */
+		void load(string filename, int threads)
+		{
+			MappedFile file(filename);
+			if(!file.is_open())
+			{
+				cout << "Could not open file to read.""\n"; // if the open file fails.
+				return;
+			}
+			string_view text = file.text();
+			threads = max(1, min(threads, shard_count()));
+
+			// Strings with escapes are decoded into scratch space; keep those
+			vector<pair<string_view, string_view> > entries;
+			StringArena decoded;
+			auto keep = [&](string_view s) {
+				bool inside = s.data() >= text.data() && s.data() + s.size() <= text.data() + text.size();
+				return inside ? s : decoded.copy(s);
+			};
+			size_t errorAt;
+			bool ok = for_each_dict_entry(text, threads, [&](string_view word, string_view def) {
+				entries.emplace_back(keep(word), keep(def));
+			}, errorAt);
+
+			// Hash each key once, in parallel
+			vector<uint32_t> shardOf(entries.size());
+			auto spread = [&](int w) {
+				size_t begin = entries.size() * w / threads, end = entries.size() * (w + 1) / threads;
+				for(size_t i = begin; i < end; i++)
+					shardOf[i] = shard_index(entries[i].first);
+			};
+			auto insert_owned = [&](int w) {
+				for(size_t i = 0; i < entries.size(); i++)
+				{
+					if((int)(shardOf[i] % threads) != w)
+						continue;
+					Shard & s = shards[shardOf[i]];
+					unique_lock<shared_mutex> held(s.lock);
+					s.table.emplace(entries[i].first, entries[i].second);
+				}
+			};
+			auto run = [threads](auto step) {
+				vector<thread> workers;
+				for(int w = 1; w < threads; w++)
+					workers.emplace_back(step, w);
+				step(0);
+				for(thread & t : workers)
+					t.join();
+			};
+			run(spread);
+			run(insert_owned);
+			if(!ok)
+				cout << "Malformed JSON in " << filename << " at byte " << errorAt << "\n";
+		}
+};
+
+#endif
@@ -7,24 +7,76 @@
 #define __DICT_H
 
 #include "hashtable.h"
+#include "prefixindex.h"
+#include "spellindex.h"
 #include "word.h"
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
 
 
 class Dictionary
 {
 
 	private:
-		Hashtable<string, Word> _dict;  // Primary dictionary store
+		typedef Utf8UpperKeys Keys;     // Words match regardless of case
+		Hashtable<string, Word, SeededHash, PrimeSizing, Keys> _dict;  // Primary dictionary store
+		PrefixIndex _prefixes;          // Words of _dict, for complete
+		bool _prefixesStale;            // _dict was bulk loaded since _prefixes was built
+		SpellIndex _spelling;           // Words of _dict, for suggestions
+		bool _spellingStale;            // Likewise for _spelling
 
-	
-	
+		/**
+		 *  Rebuild the prefix index from the table after bulk changes
+		 *   Deferred to the first complete, so loads stay as fast as
+		 *   they were (and a snapshot stays mapped)
+		 */
+		void refresh_prefixes()
+		{
+			if(!_prefixesStale)
+				return;
+			vector<string_view> words;
+			words.reserve(_dict.size());
+			_dict.for_each([&words](const Word & w) { words.push_back(w.myword); });
+			_prefixes.assign(words);
+			_prefixesStale = false;
+		}
+
+		/**
+		 *  Print words close to a word that define did not find
+		 *   The spelling index is built on the first miss after a bulk
+		 *   change; removed words stay in it and are skipped here
+		 */
+		void suggest(string_view raw)
+		{
+			NormalizedKey<Keys> word(raw);
+			if(_spellingStale)
+			{
+				vector<string_view> words;
+				words.reserve(_dict.size());
+				_dict.for_each([&words](const Word & w) { words.push_back(w.myword); });
+				_spelling.assign(words);
+				_spellingStale = false;
+			}
+			vector<string> close;
+			_spelling.suggest(word.view(), 5, close, [this](string_view w) { return _dict.contains(w); });
+			if(close.empty())
+			{
+				cout<<"the word was not found"<<endl;
+				return;
+			}
+			cout<<"the word was not found; did you mean:";
+			for(const string & w : close)
+				cout<<" "<<w;
+			cout<<endl;
+		}
 
 	public:
 		Dictionary()	// Default constructor
-		 { }
+		  : _prefixesStale(false), _spellingStale(false) { }
 
 	/**
 	 *  Run the main dictionary user interface
@@ -68,7 +120,8 @@ class Dictionary
 				{
 	
 					temp=line.substr(found1+1, line.length());
-					_dict.remove(temp);
+					if(_dict.remove(temp) && !_prefixesStale)
+						_prefixes.remove(NormalizedKey<Keys>(temp).view());
 				}
 				else  //if there is not quote around word
 				{
@@ -112,12 +165,13 @@ class Dictionary
 				}
 			
 	
-			for(unsigned int i = 0; i < word.length(); i++)
-			  word[i] = toupper(word[i]);
-			
-			cout<<word<<endl;
-			Word newWord(word,def);
-			_dict.insert(word,newWord);
+			NormalizedKey<Keys> key(word);
+			cout<<key.view()<<endl;
+			_dict.emplace(word, def);
+			if(!_prefixesStale)
+				_prefixes.insert(key.view());
+			if(!_spellingStale)
+				_spelling.insert(key.view());
 		}
 		else if(command =="define")
 		{
@@ -127,13 +181,51 @@ class Dictionary
 			{
 			
 							temp=line.substr(found1+1, line.length());
-							_dict.define(temp);
+							if(!_dict.define(temp))
+								suggest(temp);
 						}
 						else  //if there is not quote around word
 						{
 						cout<<"the word was not found"<<endl;
 						}
 		}
+		else if(command == "complete")
+		{
+			size_t start = line.find(space);
+
+			if(start != string::npos) //if there is a prefix
+			{
+				temp=line.substr(start+1);
+				long num = 10;
+				bool counted = true;
+				size_t count = temp.find(space);
+				if(count != string::npos) //if there is a count after it
+				{
+					const char * digits = temp.c_str() + count + 1;
+					char * end;
+					errno = 0;
+					num = strtol(digits, &end, 10);
+					counted = end != digits && *end == '\0' && errno != ERANGE && num >= 0;
+					temp=temp.substr(0, count);
+				}
+				if(!counted)
+				{
+					cout<<"the count must be a whole number"<<endl;
+				}
+				else
+				{
+					NormalizedKey<Keys> prefix(temp);
+					refresh_prefixes();
+					size_t shown = _prefixes.complete(prefix.view(), num, [](string_view w) { cout<<w<<endl; });
+					if(shown == 0)
+						cout<<"no words start with "<<prefix.view()<<endl;
+				}
+			}
+			else  //if there is no prefix
+			{
+			cout<<"the prefix was not found"<<endl;
+			}
+		}
 		else if(command == "print")
 		{
 			int num;
@@ -174,13 +266,30 @@ class Dictionary
 			{
 
 				temp=line.substr(found1+1, line.length());
-				_dict.load(temp);
+				_dict.load(temp, thread::hardware_concurrency());
+				_prefixesStale = true;
+				_spellingStale = true;
 			}
 			else  //if there is not quote around word
 			{
 			cout<<"the filename was not found"<<endl;
 			}
 		}
+		else if(command =="save")
+		{
+			found1=line.find(space);
+
+			if(found1>0) //if there is a filename
+			{
+
+				temp=line.substr(found1+1, line.length());
+				_dict.save(temp);
+			}
+			else  //if there is no filename
+			{
+			cout<<"the filename was not found"<<endl;
+			}
+		}
 		else if(command =="unload")
 		{
 			found1=line.find(space);
@@ -189,7 +298,9 @@ class Dictionary
 			{
 
 				temp=line.substr(found1+1, line.length());
-				_dict.unload(temp);
+				int removed = _dict.unload(temp, thread::hardware_concurrency());
+				_prefixesStale = true;
+				cout<<"removed "<<removed<<" words"<<endl;
 			}
 			else  //if there is not quote around word
 			{
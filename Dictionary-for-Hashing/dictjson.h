@@ -0,0 +1,990 @@
+/**
+ *  dictjson.h - Memory-mapped, SIMD-scanned reader for dictionary JSON
+ *
+ */
+
+#ifndef __DICT_JSON_H
+#define __DICT_JSON_H
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include "stringarena.h"
+
+#if !defined(HT_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#elif !defined(HT_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DICT_HAVE_MMAP 1
+#endif
+
+using namespace std;
+
+/*
+ *  Read-only view of a whole file
+ *   Mapped straight from the page cache where mmap exists; read into a
+ *   string otherwise (and for empty files, which cannot be mapped).
+ *   The kernel is told to read ahead unless sequential is false.
+ */
+class MappedFile
+{
+	public:
+		explicit MappedFile( const string & filename, bool sequential = true )
+		  : data(nullptr), length(0), opened(false)
+		{
+#ifdef DICT_HAVE_MMAP
+			int fd = open(filename.c_str(), O_RDONLY);
+			if(fd < 0)
+				return;
+			struct stat info;
+			if(fstat(fd, &info) == 0 && info.st_size > 0)
+			{
+				void * p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(p != MAP_FAILED)
+				{
+					madvise(p, info.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+					data = static_cast<const char *>(p);
+					length = info.st_size;
+				}
+			}
+			close(fd);
+			opened = true;
+			if(data != nullptr)
+				return;
+#endif
+			ifstream in(filename.c_str(), ios::binary);
+			if(!in.is_open())
+				return;
+			ostringstream all;
+			all << in.rdbuf();
+			copy = all.str();
+			opened = true;
+		}
+
+		~MappedFile()
+		{
+#ifdef DICT_HAVE_MMAP
+			if(data != nullptr)
+				munmap(const_cast<char *>(data), length);
+#endif
+		}
+
+		MappedFile( const MappedFile & ) = delete;
+		MappedFile & operator=( const MappedFile & ) = delete;
+
+		bool is_open() const
+		{
+			return opened;
+		}
+
+		string_view text() const
+		{
+			return data != nullptr ? string_view(data, length) : string_view(copy);
+		}
+
+	private:
+		const char * data;  // Mapping, or nullptr when copy holds the file
+		size_t length;
+		bool opened;
+		string copy;
+};
+
+/*
+ *  Stage 1: structural scanning, simdjson style
+ *   The input is classified 64 bytes at a time into bitmasks of quotes,
+ *   backslashes and structural characters ({}[]:,) with SIMD compares
+ *   (AVX2, SSE2, or a scalar loop with HT_NO_SIMD / elsewhere). Quotes
+ *   preceded by an odd run of backslashes are dropped, a prefix XOR of
+ *   the remaining quotes gives the inside-string mask, and structurals
+ *   inside strings are dropped. What is left, plus every real quote, is
+ *   the structural index: positions only, produced a chunk at a time so
+ *   multi-gigabyte files never need an index of their own size.
+ */
+class JsonStructuralScanner
+{
+	public:
+		/**
+		 *  Scan text[begin, end), which starts inside a string if
+		 *   startInString and must not start inside an escape
+		 */
+		explicit JsonStructuralScanner( string_view theText, size_t begin = 0,
+		                                size_t end = string_view::npos, bool startInString = false )
+		  : text(theText), scanned(begin), limit(min(end, theText.size())),
+		    prevInString(startInString ? ~(uint64_t)0 : 0), prevEscaped(0), at(0) { }
+
+		/**
+		 *  Position of the next structural character or quote
+		 *   Returns false once the input is exhausted
+		 */
+		bool next(size_t & pos)
+		{
+			while(at == found.size())
+			{
+				if(scanned >= limit)
+					return false;
+				fill();
+			}
+			pos = found[at++];
+			return true;
+		}
+
+		/**
+		 *  True if the input ended inside a string
+		 *   (valid once next() has returned false)
+		 */
+		bool unclosed_string() const
+		{
+			return prevInString != 0;
+		}
+
+	private:
+		static const size_t CHUNK = 16 * 1024;  // Bytes scanned per refill
+
+		string_view text;
+		size_t scanned;             // Start of the next block to classify
+		size_t limit;               // End of the scanned range
+		uint64_t prevInString;      // All ones if the last block ended in a string
+		uint64_t prevEscaped;       // 1 if the last block ended on an open escape
+		vector<size_t> found;       // Structural positions from the last refill
+		size_t at;
+
+		/**
+		 *  Bitmasks of quotes, backslashes and {}[]:, in 64 bytes at p
+		 */
+		static void classify(const char * p, uint64_t & quote, uint64_t & backslash, uint64_t & op)
+		{
+#if !defined(HT_NO_SIMD) && defined(__AVX2__)
+			quote = backslash = op = 0;
+			for(int half = 0; half < 2; half++)
+			{
+				__m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * half));
+				uint64_t q = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+				uint64_t b = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+				// { and } differ from [ and ] only in bit 0x20, so fold that bit away
+				__m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+				__m256i ops = _mm256_or_si256(
+				    _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+				                    _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+				    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+				                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+				uint64_t o = (uint32_t)_mm256_movemask_epi8(ops);
+				quote |= q << (32 * half);
+				backslash |= b << (32 * half);
+				op |= o << (32 * half);
+			}
+#elif !defined(HT_NO_SIMD) && defined(__SSE2__)
+			quote = backslash = op = 0;
+			for(int part = 0; part < 4; part++)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * part));
+				uint64_t q = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+				uint64_t b = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+				__m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+				__m128i ops = _mm_or_si128(
+				    _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+				                 _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+				    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+				                 _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+				uint64_t o = (uint32_t)_mm_movemask_epi8(ops);
+				quote |= q << (16 * part);
+				backslash |= b << (16 * part);
+				op |= o << (16 * part);
+			}
+#else
+			quote = backslash = op = 0;
+			for(int i = 0; i < 64; i++)
+			{
+				char c = p[i];
+				uint64_t bit = (uint64_t)1 << i;
+				if(c == '"')
+					quote |= bit;
+				else if(c == '\\')
+					backslash |= bit;
+				else if(c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')
+					op |= bit;
+			}
+#endif
+		}
+
+		/**
+		 *  Bits of characters escaped by a backslash, carrying runs of
+		 *   backslashes across blocks through prevEscaped
+		 */
+		uint64_t escaped_chars(uint64_t backslash)
+		{
+			const uint64_t evenBits = 0x5555555555555555ull;
+			backslash &= ~prevEscaped;
+			uint64_t followsEscape = (backslash << 1) | prevEscaped;
+			uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+			uint64_t evenStarts;
+			prevEscaped = __builtin_add_overflow(oddStarts, backslash, &evenStarts);
+			uint64_t invert = evenStarts << 1;
+			return (evenBits ^ invert) & followsEscape;
+		}
+
+		static uint64_t prefix_xor(uint64_t x)
+		{
+			x ^= x << 1;
+			x ^= x << 2;
+			x ^= x << 4;
+			x ^= x << 8;
+			x ^= x << 16;
+			x ^= x << 32;
+			return x;
+		}
+
+		/**
+		 *  Classify the next CHUNK bytes into found
+		 */
+		void fill()
+		{
+			found.clear();
+			at = 0;
+			size_t stop = min(limit, scanned + CHUNK);
+			for(; scanned < stop; scanned += 64)
+			{
+				const char * p = text.data() + scanned;
+				char tail[64];
+				if(scanned + 64 > limit)
+				{
+					// Last partial block: pad with spaces
+					memset(tail, ' ', 64);
+					memcpy(tail, p, limit - scanned);
+					p = tail;
+				}
+				uint64_t quote, backslash, op;
+				classify(p, quote, backslash, op);
+				quote &= ~escaped_chars(backslash);
+				uint64_t inString = prefix_xor(quote) ^ prevInString;
+				prevInString = (uint64_t)((int64_t)inString >> 63);
+				uint64_t structural = (op & ~inString) | quote;
+				while(structural)
+				{
+					found.push_back(scanned + __builtin_ctzll(structural));
+					structural &= structural - 1;
+				}
+			}
+		}
+};
+
+/*
+ *  Stage 2: walk the structural index and report dictionary entries
+ *   Any well-formed JSON is accepted, with any whitespace and layout.
+ *   Every object holding string members "word" and "definition" is
+ *   reported as one entry, wherever it is nested.
+ *
+ *   Strings span from one quote in the index to the next, so their
+ *   bytes are never looked at one by one; those without escapes are
+ *   handed out as views straight into the input. Only strings with
+ *   escapes are decoded, into a scratch buffer that lives until the
+ *   callback returns. Scalars (numbers, true, false, null) are the
+ *   text between two structurals and are checked but not converted.
+ */
+class DictJsonParser
+{
+	public:
+		/**
+		 *  Takes over the run of array elements at the skip position: sets
+		 *   where parsing resumes (the structural after the run, and the
+		 *   first byte after the one before it), or returns false with the
+		 *   offset of an error in the run
+		 */
+		typedef function<bool(size_t & resumeAt, size_t & resumeLast, size_t & errorPos)> SKIP;
+
+		explicit DictJsonParser( string_view theText )
+		  : text(theText), scanner(theText), skipAt(string_view::npos), pos(0), last(0),
+		    have(false), errorAt(0), failed(false), resumeAt(0), resumeLast(0) { }
+
+		/**
+		 *  Call f( word, definition ) for every entry in document order
+		 *   Returns false on malformed JSON; entries before the error
+		 *   have already been reported
+		 */
+		template <typename FUNC>
+		bool for_each_entry( FUNC && f )
+		{
+			return for_each_entry(f, string_view::npos, SKIP());
+		}
+
+		/**
+		 *  Like for_each_entry, except that once an array element starts
+		 *   at theSkipAt, theSkip covers it and the elements after it
+		 */
+		template <typename FUNC>
+		bool for_each_entry( FUNC && f, size_t theSkipAt, SKIP theSkip )
+		{
+			skipAt = theSkipAt;
+			skip = std::move(theSkip);
+			start(0);
+			value(f, 0);
+			if(have || scanner.unclosed_string())
+				fail();
+			else if(!failed && !is_space(last, text.size()))
+				fail();
+			return !failed;
+		}
+
+		/**
+		 *  Call f( word, definition ) for the entries in a run of array
+		 *   elements: the one at begin, depth containers deep, and those
+		 *   after it up to the element at stopAt or the end of the array
+		 *   resume_at() and resume_last() then tell where the run ended
+		 */
+		template <typename FUNC>
+		bool for_each_element( FUNC && f, size_t begin, size_t stopAt, int depth )
+		{
+			skipAt = string_view::npos;
+			start(begin);
+			while(!failed)
+			{
+				value(f, depth);
+				if(failed || current() != ',')
+					break;
+				expect(',');
+				if(have && pos == stopAt)
+				{
+					if(!is_space(last, pos))
+						fail();
+					break;
+				}
+			}
+			resumeAt = have ? pos : text.size();
+			resumeLast = last;
+			return !failed;
+		}
+
+		/**
+		 *  Byte offset of the first error
+		 */
+		size_t error_offset() const
+		{
+			return errorAt;
+		}
+
+		size_t resume_at() const
+		{
+			return resumeAt;
+		}
+
+		size_t resume_last() const
+		{
+			return resumeLast;
+		}
+
+	private:
+		static const int MAX_DEPTH = 256;
+
+		string_view text;
+		JsonStructuralScanner scanner;
+		size_t skipAt;      // Element handed to skip, npos for none
+		SKIP skip;
+		size_t pos;         // Current structural, valid while have
+		size_t last;        // First byte after the previous structural
+		bool have;
+		size_t errorAt;
+		bool failed;
+		size_t resumeAt;    // Where for_each_element stopped
+		size_t resumeLast;
+
+		void fail()
+		{
+			if(!failed)
+			{
+				failed = true;
+				errorAt = have ? pos : text.size();
+			}
+		}
+
+		char current() const
+		{
+			return have ? text[pos] : '\0';
+		}
+
+		/**
+		 *  Scan from begin, which must be outside any string
+		 */
+		void start(size_t begin)
+		{
+			scanner = JsonStructuralScanner(text, begin);
+			errorAt = 0;
+			failed = false;
+			advance_from(begin);
+		}
+
+		void advance_from(size_t from)
+		{
+			last = from;
+			have = scanner.next(pos);
+		}
+
+		/**
+		 *  Hand the element run at the current structural to skip and
+		 *   carry on where it ended
+		 */
+		void skip_run()
+		{
+			size_t resume, resumeFrom, errorPos;
+			skipAt = string_view::npos;
+			if(!skip(resume, resumeFrom, errorPos))
+			{
+				failed = true;
+				errorAt = errorPos;
+				return;
+			}
+			scanner = JsonStructuralScanner(text, resume);
+			advance_from(resumeFrom);
+		}
+
+		/**
+		 *  Step past the current structural
+		 */
+		void advance()
+		{
+			advance_from(pos + 1);
+		}
+
+		/**
+		 *  True if text[from, to) is only JSON whitespace
+		 */
+		bool is_space(size_t from, size_t to) const
+		{
+			for(size_t i = from; i < to; i++)
+			{
+				char c = text[i];
+				if(c != ' ' && c != '\n' && c != '\r' && c != '\t')
+					return false;
+			}
+			return true;
+		}
+
+		/**
+		 *  Consume structural c, with nothing but whitespace before it
+		 */
+		bool expect(char c)
+		{
+			if(!have || text[pos] != c || !is_space(last, pos))
+			{
+				fail();
+				return false;
+			}
+			advance();
+			return true;
+		}
+
+		static int hex_digit(char c)
+		{
+			if(c >= '0' && c <= '9') return c - '0';
+			if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+
+		static bool read_hex4(string_view s, size_t & i, unsigned int & code)
+		{
+			if(i + 4 > s.size())
+				return false;
+			code = 0;
+			for(int k = 0; k < 4; k++)
+			{
+				int d = hex_digit(s[i + k]);
+				if(d < 0)
+					return false;
+				code = code * 16 + d;
+			}
+			i += 4;
+			return true;
+		}
+
+		static void append_utf8(string & out, unsigned int code)
+		{
+			if(code < 0x80)
+				out += (char)code;
+			else if(code < 0x800)
+			{
+				out += (char)(0xC0 | (code >> 6));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			else if(code < 0x10000)
+			{
+				out += (char)(0xE0 | (code >> 12));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += (char)(0xF0 | (code >> 18));
+				out += (char)(0x80 | ((code >> 12) & 0x3F));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+		}
+
+		/**
+		 *  Decode the escapes in raw (a string's body) into scratch
+		 */
+		bool unescape(string_view raw, string & scratch)
+		{
+			scratch.clear();
+			for(size_t i = 0; i < raw.size(); )
+			{
+				size_t slash = raw.find('\\', i);
+				if(slash == string_view::npos)
+				{
+					scratch.append(raw.data() + i, raw.size() - i);
+					break;
+				}
+				scratch.append(raw.data() + i, slash - i);
+				i = slash + 1;
+				if(i == raw.size())
+					return false;
+				unsigned int code;
+				switch(raw[i++])
+				{
+					case '"':  scratch += '"';  break;
+					case '\\': scratch += '\\'; break;
+					case '/':  scratch += '/';  break;
+					case 'b':  scratch += '\b'; break;
+					case 'f':  scratch += '\f'; break;
+					case 'n':  scratch += '\n'; break;
+					case 'r':  scratch += '\r'; break;
+					case 't':  scratch += '\t'; break;
+					case 'u':
+						if(!read_hex4(raw, i, code))
+							return false;
+						if(code >= 0xD800 && code < 0xDC00 && i + 6 <= raw.size()
+						   && raw[i] == '\\' && raw[i + 1] == 'u')
+						{
+							// Surrogate pair
+							unsigned int low;
+							i += 2;
+							if(!read_hex4(raw, i, low) || low < 0xDC00 || low >= 0xE000)
+								return false;
+							code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						}
+						append_utf8(scratch, code);
+						break;
+					default:
+						return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 *  Parse the string whose opening quote is the current structural
+		 *   Returns a view of the input, or of scratch if it had escapes
+		 */
+		string_view parse_string(string & scratch)
+		{
+			if(!expect('"'))
+				return string_view();
+			size_t start = last;
+			if(!have || text[pos] != '"')
+			{
+				fail();
+				return string_view();
+			}
+			string_view raw = text.substr(start, pos - start);
+			advance();
+			if(memchr(raw.data(), '\\', raw.size()) == nullptr)
+				return raw;
+			if(!unescape(raw, scratch))
+			{
+				fail();
+				return string_view();
+			}
+			return scratch;
+		}
+
+		/**
+		 *  Check the number, true, false or null ending at the current structural
+		 */
+		void parse_scalar()
+		{
+			size_t end = have ? pos : text.size();
+			size_t start = last;
+			while(start < end && is_space(start, start + 1))
+				start++;
+			while(end > start && is_space(end - 1, end))
+				end--;
+			string_view token = text.substr(start, end - start);
+			if(token.empty())
+			{
+				fail();
+				return;
+			}
+			if(token != "true" && token != "false" && token != "null")
+			{
+				for(char c : token)
+				{
+					if(!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+					{
+						fail();
+						return;
+					}
+				}
+			}
+			last = have ? pos : text.size();
+		}
+
+		template <typename FUNC>
+		void value(FUNC & f, int depth)
+		{
+			if(depth > MAX_DEPTH)
+			{
+				fail();
+				return;
+			}
+			char c = current();
+			if((c == '{' || c == '[' || c == '"') && !is_space(last, pos))
+				fail();
+			else if(c == '{')
+				object(f, depth);
+			else if(c == '[')
+				array(f, depth);
+			else if(c == '"')
+			{
+				string scratch;
+				parse_string(scratch);
+			}
+			else
+				parse_scalar();
+		}
+
+		template <typename FUNC>
+		void array(FUNC & f, int depth)
+		{
+			advance();
+			if(current() == ']' && is_space(last, pos))
+			{
+				advance();
+				return;
+			}
+			while(!failed)
+			{
+				if(have && pos == skipAt && is_space(last, pos))
+					skip_run();
+				else
+					value(f, depth + 1);
+				if(failed)
+					return;
+				if(current() == ',')
+					expect(',');
+				else
+				{
+					expect(']');
+					return;
+				}
+			}
+		}
+
+		template <typename FUNC>
+		void object(FUNC & f, int depth)
+		{
+			string keyScratch, wordScratch, defScratch;
+			string_view word, def;
+			bool haveWord = false, haveDef = false;
+
+			advance();
+			if(current() == '}' && is_space(last, pos))
+			{
+				advance();
+				return;
+			}
+			while(!failed)
+			{
+				string_view key = parse_string(keyScratch);
+				if(failed || !expect(':'))
+					return;
+				if(current() == '"' && key == "word")
+				{
+					word = parse_string(wordScratch);
+					haveWord = true;
+				}
+				else if(current() == '"' && key == "definition")
+				{
+					def = parse_string(defScratch);
+					haveDef = true;
+				}
+				else
+					value(f, depth + 1);
+				if(failed)
+					return;
+				if(current() == ',')
+					expect(',');
+				else
+				{
+					if(expect('}') && haveWord && haveDef)
+						f(word, def);
+					return;
+				}
+			}
+		}
+};
+
+/*
+ *  Parallel parsing
+ *   The text is cut into chunks that each start right after a newline,
+ *   and every chunk is first scanned on its own thread for a summary
+ *   only: whether it ends inside a string, how its bracket depth moves,
+ *   and the first object in it that follows a comma, which can only be
+ *   an array element. Nothing is kept per structural. A chunk's real
+ *   start state depends only on the summaries before it, so chaining
+ *   them gives every chunk's depth, and the rare chunk that guessed its
+ *   string state wrong (raw newlines inside strings) is summarized again.
+ *
+ *   Element starts at the same depth, with the array never closing in
+ *   between, are the cuts: each run of elements from one cut to the next
+ *   is parsed on its own thread by its own streaming parser, straight
+ *   into its own part. The calling thread parses what comes before the
+ *   first cut and after the last run, so the parts cover the document in
+ *   order. A document with no usable cuts is parsed as one part.
+ */
+static const size_t DICT_MIN_CHUNK = 1 << 20;   // Smallest chunk worth a thread
+
+struct JsonChunkSummary
+{
+	bool endsInString = false;
+	long depthChange = 0;         // Brackets opened minus closed
+	long lowest = 0;              // Lowest depth reached, from 0 at the start
+	char final = '\0';            // Last structural, '\0' if there is none
+	size_t cut = string_view::npos;   // First '{' right after a ','
+	bool cutAtStart = false;      // It is the first structural; its ',' is earlier
+	long cutDepth = 0;            // Depth just before the cut
+	long lowestBefore = 0;        // Lowest depth before the cut (all of it if none)
+	long lowestAfter = 0;         // Lowest depth from the cut on
+};
+
+/**
+ *  Summarize text[begin, end), which starts inside a string if
+ *   startInString; streams through the scanner without keeping positions
+ */
+inline JsonChunkSummary summarize_json_chunk( string_view text, size_t begin, size_t end, bool startInString )
+{
+	JsonChunkSummary s;
+	JsonStructuralScanner scanner(text, begin, end, startInString);
+	long depth = 0;
+	char prev = '\0';
+	size_t pos;
+	while(scanner.next(pos))
+	{
+		char c = text[pos];
+		if(c == '{' && s.cut == string_view::npos && (prev == ',' || prev == '\0'))
+		{
+			s.cut = pos;
+			s.cutAtStart = prev == '\0';
+			s.cutDepth = depth;
+			s.lowestAfter = depth;
+		}
+		if(c == '{' || c == '[')
+			depth++;
+		else if(c == '}' || c == ']')
+			depth--;
+		if(s.cut == string_view::npos)
+			s.lowestBefore = min(s.lowestBefore, depth);
+		else
+			s.lowestAfter = min(s.lowestAfter, depth);
+		s.lowest = min(s.lowest, depth);
+		prev = c;
+	}
+	s.final = prev;
+	s.depthChange = depth;
+	s.endsInString = scanner.unclosed_string();
+	return s;
+}
+
+/**
+ *  Cut positions for parsing text on up to threads threads, all element
+ *   starts of one array that is depth containers deep; none if the text
+ *   is too small to share out or has no such array
+ */
+inline void plan_dict_cuts( string_view text, int threads, size_t minChunk, vector<size_t> & cuts, int & depth )
+{
+	cuts.clear();
+	depth = 0;
+	size_t n = max(1, threads);
+	n = max<size_t>(1, min(n, text.size() / max<size_t>(minChunk, 1)));
+	vector<size_t> bounds(1, 0);
+	for(size_t i = 1; i < n; i++)
+	{
+		// A newline right after a backslash could be an escape
+		size_t b = text.find('\n', max(bounds.back(), i * text.size() / n));
+		while(b != string_view::npos && b > 0 && text[b - 1] == '\\')
+			b = text.find('\n', b + 1);
+		if(b == string_view::npos)
+			break;
+		bounds.push_back(b + 1);
+	}
+	bounds.push_back(text.size());
+	size_t count = bounds.size() - 1;
+	if(count < 2)
+		return;
+
+	vector<JsonChunkSummary> sums(count);
+	vector<thread> workers;
+	for(size_t i = 1; i < count; i++)
+		workers.emplace_back([&, i]() { sums[i] = summarize_json_chunk(text, bounds[i], bounds[i + 1], false); });
+	sums[0] = summarize_json_chunk(text, bounds[0], bounds[1], false);
+	for(thread & t : workers)
+		t.join();
+
+	// Chain the chunks in order; stop once the chosen array closes
+	bool inString = false;
+	long at = 0, arrayDepth = 0;
+	char before = '\0';
+	for(size_t i = 0; i < count; i++)
+	{
+		if(inString)
+			sums[i] = summarize_json_chunk(text, bounds[i], bounds[i + 1], true);
+		const JsonChunkSummary & s = sums[i];
+		if(!cuts.empty() && at + s.lowestBefore < arrayDepth)
+			break;
+		bool usable = s.cut != string_view::npos && (!s.cutAtStart || before == ',');
+		if(usable && (cuts.empty() || at + s.cutDepth == arrayDepth))
+		{
+			if(cuts.empty())
+				arrayDepth = at + s.cutDepth;
+			cuts.push_back(s.cut);
+			if(at + s.lowestAfter < arrayDepth)
+				break;
+		}
+		else if(!cuts.empty() && at + s.lowest < arrayDepth)
+			break;
+		at += s.depthChange;
+		inString = s.endsInString;
+		if(s.final != '\0')
+			before = s.final;
+	}
+	depth = arrayDepth;
+}
+
+/**
+ *  Call f( part, word, definition ) for every entry of text, using up to
+ *   threads threads
+ *   Parts number the document's pieces in order from 0, and are always
+ *   under threads + 2. A part's entries come in document order from one
+ *   thread; different parts are filled at the same time. Only parts 0
+ *   to parts - 1 count: on an error the part it happened in is the last
+ *   of them, holding the entries before the error, and f may have seen
+ *   entries for later parts, which are to be dropped.
+ *   Returns false on malformed JSON, with the offset of the error in errorAt
+ */
+template <typename FUNC>
+bool for_each_dict_part( string_view text, int threads, FUNC && f, int & parts, size_t & errorAt,
+                         size_t minChunk = DICT_MIN_CHUNK )
+{
+	vector<size_t> cuts;
+	int depth;
+	plan_dict_cuts(text, threads, minChunk, cuts, depth);
+	size_t m = cuts.size();
+
+	struct Run
+	{
+		bool ok;
+		size_t errorAt;
+		size_t resumeAt;
+		size_t resumeLast;
+	};
+	vector<Run> runs(m);
+	auto run = [&](size_t k) {
+		DictJsonParser parser(text);
+		size_t stop = k + 1 < m ? cuts[k + 1] : string_view::npos;
+		int part = k + 1;
+		bool ok = parser.for_each_element([&f, part](string_view word, string_view def) { f(part, word, def); },
+		                                  cuts[k], stop, depth);
+		runs[k] = Run{ ok, parser.error_offset(), parser.resume_at(), parser.resume_last() };
+		if(ok && stop != string_view::npos && runs[k].resumeAt != stop)
+			runs[k] = Run{ false, runs[k].resumeAt, 0, 0 };   // Missing ',' between elements
+	};
+	vector<thread> workers;
+	for(size_t k = 1; k < m; k++)
+		workers.emplace_back(run, k);
+	auto join = [&workers]() {
+		for(thread & t : workers)
+			t.join();
+		workers.clear();
+	};
+
+	int part = 0;
+	DictJsonParser driver(text);
+	bool ok = driver.for_each_entry([&f, &part](string_view word, string_view def) { f(part, word, def); },
+	                                m > 0 ? cuts[0] : string_view::npos,
+	                                [&](size_t & resumeAt, size_t & resumeLast, size_t & errorPos) {
+		run(0);
+		join();
+		for(size_t k = 0; k < m; k++)
+		{
+			if(!runs[k].ok)
+			{
+				part = k + 1;
+				errorPos = runs[k].errorAt;
+				return false;
+			}
+		}
+		part = m + 1;
+		resumeAt = runs[m - 1].resumeAt;
+		resumeLast = runs[m - 1].resumeLast;
+		return true;
+	});
+	join();
+	parts = part + 1;
+	errorAt = driver.error_offset();
+	return ok;
+}
+
+/**
+ *  Call f( word, definition ) for every entry of text in document order,
+ *   parsing on up to threads threads
+ *   Entries of later parts are held until the parts before them are
+ *   done; views of decoded strings stay valid until f returns
+ *   Returns false on malformed JSON, with the offset of the error in errorAt
+ */
+template <typename FUNC>
+bool for_each_dict_entry( string_view text, int threads, FUNC && f, size_t & errorAt )
+{
+	bool ok;
+	if(threads <= 1)
+	{
+		DictJsonParser parser(text);
+		ok = parser.for_each_entry(f);
+		errorAt = parser.error_offset();
+		return ok;
+	}
+	struct Part
+	{
+		vector<pair<string_view, string_view> > entries;
+		StringArena decoded;    // Strings with escapes, which views of text cannot hold
+	};
+	vector<Part> held(threads + 2);
+	auto keep = [text](Part & p, string_view s) {
+		bool inside = s.data() >= text.data() && s.data() + s.size() <= text.data() + text.size();
+		return inside ? s : p.decoded.copy(s);
+	};
+	int parts;
+	ok = for_each_dict_part(text, threads, [&](int part, string_view word, string_view def) {
+		Part & p = held[part];
+		p.entries.emplace_back(keep(p, word), keep(p, def));
+	}, parts, errorAt);
+	for(int i = 0; i < parts; i++)
+	{
+		for(const pair<string_view, string_view> & e : held[i].entries)
+			f(e.first, e.second);
+	}
+	return ok;
+}
+
+#endif
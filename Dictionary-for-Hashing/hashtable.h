@@ -9,166 +9,1035 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <list>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <memory>
+#include <iterator>
+#include "stringarena.h"
+#include "dictjson.h"
+#include "snapshot.h"
+#include "keynorm.h"
+
+// Control-byte group width: how many slots one probe step inspects
+#if !defined(HT_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define HT_GROUP_WIDTH 32
+#elif !defined(HT_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define HT_GROUP_WIDTH 16
+#else
+#define HT_GROUP_WIDTH 8
+#endif
 
 using namespace std;
 /*
 	private:
 		void rehash();
-		int hash_function(KEYTYPE key);
+		uint64_t hash_code(LOOKUP key);
 		
 	public:
-		bool insert(KEYTYPE key, VALTYPE val);
-		bool contains(KEYTYPE key);
-		int remove(KEYTYPE key);
-		VALTYPE & find(KEYTYPE key);
+		bool insert(LOOKUP key, VALTYPE val);   // val is moved in
+		bool emplace(ARGS... args);             // Build the VALTYPE in place
+		bool contains(LOOKUP key);
+		int remove(LOOKUP key);
+		int remove_all(ITER first, ITER last);  // Batch remove, returns count
+		VALTYPE * find(LOOKUP key);            // Copies a mapped snapshot out
+		bool find(LOOKUP key, VALTYPE & out);  // Copy out the entry
+		void for_each(FUNC f);  // f(const VALTYPE &) for every entry
+		iterator begin();      // Every entry as const VALTYPE &, slot order
+		iterator end();
 		int size();            // Elements currently in table
 		bool empty();          // Is the hash empty?
 		float load_factor();   // Return current load factor
 		void clear();          // Empty out the table
 		int bucket_count();    // Total number of buckets in table
+		VALTYPE * random_entry();  // Uniform pick, nullptr if empty
+		bool random_entry(VALTYPE & out);  // Copy out a uniform pick
+		bool save(string filename);   // Write a binary snapshot
+		void load(string filename, int threads);  // JSON or snapshot
+		void absorb(Hashtable && part);           // Merge a same-seeded table
+		int unload(string filename, int threads); // Returns words removed
+		void print(int num, ostream & out);       // First num words, 0 for all
 */
 
-template <typename KEYTYPE, typename VALTYPE>
+/*
+ *  Hash policies: constructed from a 64-bit seed, then called on keys
+ *   uint64_t operator()(string_view) and uint64_t operator()(int)
+ */
+
+/**
+ *  Fast seeded 64-bit hash (wyhash style)
+ *   Strings are consumed as 64-bit words, two per step, each step one
+ *   64x64->128 multiply folded back to 64 bits; keys up to 16 bytes
+ *   take no loop at all. The seed is mixed in first, so without it
+ *   nobody can precompute a set of colliding words.
+ */
+struct SeededHash
+{
+	uint64_t seed;
+
+	explicit SeededHash(uint64_t theSeed = 0) : seed(theSeed) { }
+
+	static uint64_t mum(uint64_t a, uint64_t b)
+	{
+#ifdef __SIZEOF_INT128__
+		unsigned __int128 r = (unsigned __int128)a * b;
+		return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+		uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+		uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+		uint64_t mid = (ll >> 32) + (uint32_t)hl + (uint32_t)lh;
+		uint64_t lo = (mid << 32) | (uint32_t)ll;
+		uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+		return lo ^ hi;
+#endif
+	}
+
+	static uint64_t read8(const char * p) { uint64_t v; memcpy(&v, p, 8); return v; }
+	static uint64_t read4(const char * p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+	uint64_t operator()(string_view key) const
+	{
+		const char * p = key.data();
+		size_t n = key.size();
+		uint64_t s = seed ^ 0xA0761D6478BD642Full;
+		uint64_t a, b;
+		if(n <= 16)
+		{
+			// Short keys: two overlapping reads cover every byte, no loop
+			if(n >= 4)
+			{
+				size_t mid = (n >> 3) << 2;
+				a = (read4(p) << 32) | read4(p + mid);
+				b = (read4(p + n - 4) << 32) | read4(p + n - 4 - mid);
+			}
+			else if(n > 0)
+			{
+				a = ((uint64_t)(unsigned char)p[0] << 16)
+				  | ((uint64_t)(unsigned char)p[n >> 1] << 8)
+				  | (unsigned char)p[n - 1];
+				b = 0;
+			}
+			else
+			{
+				a = b = 0;
+			}
+		}
+		else
+		{
+			for(; n > 16; p += 16, n -= 16)
+			{
+				s = mum(read8(p) ^ 0xE7037ED1A0B428DBull, read8(p + 8) ^ s);
+			}
+			a = read8(p + n - 16);
+			b = read8(p + n - 8);
+			n = key.size();
+		}
+		return mum(0xE7037ED1A0B428DBull ^ n, mum(a ^ 0xE7037ED1A0B428DBull, b ^ s));
+	}
+
+	uint64_t operator()(int key) const
+	{
+		return mum((uint64_t)(uint32_t)key ^ seed ^ 0xE7037ED1A0B428DBull, 0x8EBC6AF09C88C6E3ull);
+	}
+};
+
+/**
+ *  The original byte-at-a-time 37*h + ch polynomial, unseeded
+ *   Kept for comparison and for callers that need stable codes.
+ */
+struct PolynomialHash
+{
+	explicit PolynomialHash(uint64_t = 0) { }
+
+	uint64_t operator()(string_view key) const
+	{
+		unsigned int hashval=0;
+		for(char ch : key)
+		{
+			hashval=37*hashval+ch;
+		}
+		return hashval;
+	}
+
+	uint64_t operator()(int key) const
+	{
+		return (unsigned int)key;
+	}
+};
+
+/**
+ *  A different seed for every call: random_device entropy taken once,
+ *   stepped per call and run through a splitmix64 finalizer
+ */
+inline uint64_t fresh_hash_seed()
+{
+	static atomic<uint64_t> state(((uint64_t)random_device()() << 32)
+	                              ^ random_device()()
+	                              ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count());
+	uint64_t z = state.fetch_add(0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/**
+ *  Small seeded generator (wyrand): one add and one 128-bit multiply
+ *   per number, for sampling; not for anything secret
+ */
+struct FastRandom
+{
+	uint64_t state;
+
+	explicit FastRandom(uint64_t seed = 0) : state(seed) { }
+
+	uint64_t operator()()
+	{
+		state += 0xA0761D6478BD642Full;
+		return SeededHash::mum(state, state ^ 0xE7037ED1A0B428DBull);
+	}
+
+	/**
+	 *  Uniform in [0, n), n > 0 (Lemire's multiply-shift with rejection)
+	 */
+	uint64_t below(uint64_t n)
+	{
+#ifdef __SIZEOF_INT128__
+		unsigned __int128 m = (unsigned __int128)(*this)() * n;
+		if((uint64_t)m < n)
+		{
+			uint64_t floor = (0 - n) % n;
+			while((uint64_t)m < floor)
+				m = (unsigned __int128)(*this)() * n;
+		}
+		return (uint64_t)(m >> 64);
+#else
+		uint64_t limit = UINT64_MAX - UINT64_MAX % n, r;
+		while((r = (*this)()) >= limit)
+			;
+		return r % n;
+#endif
+	}
+};
+
+/**
+ *  Line output gathered into large blocks before it reaches the stream
+ *   One write per block instead of a write and a flush (endl) per line
+ */
+class BlockWriter
+{
+	public:
+		explicit BlockWriter(ostream & theOut, size_t theBlock = 1 << 16)
+		  : out(theOut), block(theBlock)
+		{
+			buffer.reserve(block);
+		}
+
+		~BlockWriter()
+		{
+			flush();
+		}
+
+		void line(string_view text)
+		{
+			buffer.append(text.data(), text.size());
+			buffer += '\n';
+			if(buffer.size() >= block)
+				drain();
+		}
+
+		void flush()
+		{
+			drain();
+			out.flush();
+		}
+
+	private:
+		ostream & out;
+		size_t block;
+		string buffer;
+
+		void drain()
+		{
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+};
+
+/*
+ *  Bucket sizing policies: which table sizes exist and how a hash code
+ *  is reduced to a bucket
+ *   int size_for(n)           --> smallest supported bucket count >= n
+ *   Reducer(buckets)          --> per-table state for that bucket count
+ *   int Reducer::bucket(code) --> code's home bucket in [0, buckets)
+ */
+
+/**
+ *  Prime bucket counts from a fixed, roughly doubling table
+ *   Reduction is an exact modulo done with Lemire's fastmod: one
+ *   multiply-high against a precomputed reciprocal instead of a divide.
+ */
+struct PrimeSizing
+{
+	static int size_for(int n)
+	{
+		static const int primes[] = {
+			11, 23, 53, 101, 193, 389, 769, 1543, 3079, 6151, 12289, 24593,
+			49157, 98317, 196613, 393241, 786433, 1572869, 3145739, 6291469,
+			12582917, 25165843, 50331653, 100663319, 201326611, 402653189,
+			805306457, 1610612741 };
+		const int * end = primes + sizeof(primes) / sizeof(primes[0]);
+		const int * p = lower_bound(primes, end, n);
+		return p == end ? end[-1] : *p;
+	}
+
+	struct Reducer
+	{
+		uint32_t d;
+		uint64_t M;   // ceil(2^64 / d)
+
+		explicit Reducer(int buckets = 1)
+		  : d(buckets), M(UINT64_C(0xFFFFFFFFFFFFFFFF) / buckets + 1) { }
+
+		int bucket(uint32_t code) const
+		{
+#ifdef __SIZEOF_INT128__
+			uint64_t low = M * code;
+			return (int)(((unsigned __int128)low * d) >> 64);
+#else
+			return code % d;
+#endif
+		}
+	};
+};
+
+/**
+ *  Power-of-two bucket counts
+ *   The code goes through a murmur3 finalizer first so that every input
+ *   bit reaches the masked low bits; weak hashes stay usable.
+ */
+struct PowerOfTwoSizing
+{
+	static int size_for(int n)
+	{
+		int size = 8;
+		while(size < n && size < (1 << 30))
+			size <<= 1;
+		return size;
+	}
+
+	struct Reducer
+	{
+		uint32_t mask;
+
+		explicit Reducer(int buckets = 1) : mask(buckets - 1) { }
+
+		int bucket(uint32_t code) const
+		{
+			code ^= code >> 16;
+			code *= 0x85EBCA6Bu;
+			code ^= code >> 13;
+			code *= 0xC2B2AE35u;
+			code ^= code >> 16;
+			return code & mask;
+		}
+	};
+};
+
+/*
+ *  Storage is a flat Robin Hood table: every entry lives directly in the
+ *  slots vector and dists[i] holds how far slot i sits from its home
+ *  bucket (-1 when empty). Lookups stop as soon as they pass an entry
+ *  closer to home than they are, and remove() shifts the following run
+ *  back one slot instead of leaving a tombstone.
+ *
+ *  The table never wraps: buckets home slots are followed by
+ *  MAX_PROBE overflow slots, and an insert that would need to probe
+ *  further grows the table instead.
+ *
+ *  Next to each slot sits a control byte holding a 7-bit fingerprint of
+ *  its key's hash. Lookups compare a whole group of fingerprints and
+ *  distances at once (SSE2: 16, AVX2: 32, scalar fallback: 8) and only
+ *  compare full keys on a fingerprint match, so misses almost never
+ *  touch a string. dists/ctrl carry one group of -1/0 padding so a group
+ *  load never runs off the end.
+ *
+ *  Entries that only view their text (like Word) have it copied into
+ *  the table's StringArena as they are stored: one bump allocation per
+ *  string instead of a heap string each, freed all at once by clear().
+ *  Replaced and removed entries leave their text behind; once that dead
+ *  text outweighs the live text, the live text is copied into a fresh
+ *  arena and the old blocks go, so the arena stays within a constant
+ *  factor of what the table holds.
+ *
+ *  The full 64-bit code of every entry is cached in codes: a fingerprint
+ *  hit is confirmed on the code before the strings are compared, and
+ *  growing moves entries without hashing a single key again.
+ *
+ *  A table loaded from a binary snapshot (see snapshot.h) starts out as
+ *  the mapped file itself: lookups probe the file's arrays directly and
+ *  hand out entries viewing its text pool. The first change copies the
+ *  arrays into cur and the text into the arena, then drops the mapping.
+ *
+ *  String keys go through the KEYS policy (keynorm.h) exactly once per
+ *  call, at the public boundary: stored keys are kept in normal form,
+ *  and a lookup normalizes into a stack buffer, so everything inside
+ *  hashes and compares plain bytes and a case-insensitive lookup never
+ *  allocates an uppercased copy.
+ *
+ *  Every entry also has a place in a dense array of codes, which is what
+ *  random_entry() samples from: where[] gives each slot's position in
+ *  it and travels with the entry like its code. A removal moves the last
+ *  dense code into the hole and finds that entry's slot by probing for
+ *  its code and position.
+ *
+ *  Iterators walk cur (or the snapshot) and then old in slot order,
+ *  skipping a whole group of empty slots per step, so stopping early
+ *  never looks at the slots past the last entry handed out.
+ *
+ *  Growing is incremental: the full table becomes `old`, a table twice
+ *  the size becomes `cur`, and every insert/remove after that moves
+ *  about MIGRATE_SLOTS slots of old into cur until old is empty. Lookups
+ *  check both. Migration always moves whole runs of occupied slots, so
+ *  everything in old below migratePos is empty and backward shifts in
+ *  old never carry an entry below it.
+ */
+template <typename KEYTYPE, typename VALTYPE, typename HASH = SeededHash,
+          typename SIZING = PrimeSizing, typename KEYS = ExactKeys>
 class Hashtable
 {
+	public:
+		// Lookups take string keys as string_view so probing never copies
+		typedef typename conditional<is_same<KEYTYPE, string>::value,
+		                             string_view, const KEYTYPE &>::type LOOKUP;
+
+	private:
+		// A public key in normal form: KEYS applied once, on the stack
+		typedef typename conditional<is_same<KEYTYPE, string>::value,
+		                             NormalizedKey<KEYS>, PlainKey<LOOKUP> >::type NORMAL;
+
 	private:
+		static const int MAX_PROBE = 64;        // Longest allowed probe run
+		static const int MIGRATE_SLOTS = 16;    // Old slots moved per insert/remove
+		static const int SWEEP_RATIO = 16;      // remove_all sweeps for batches over slots/this
+		static constexpr float MAX_LOAD = 0.875f; // Grow past this load factor
+		static const int MAX_GROWTHS = 2;       // Growths one new key's probe run may cause
+		static constexpr float MIN_GROW_LOAD = MAX_LOAD / 8;  // Sparser tables never grow for a run
+
+		struct Table
+		{
+			vector<VALTYPE> slots;       // Entries, buckets + MAX_PROBE of them
+			vector<signed char> dists;   // Distance from home bucket, -1 if empty
+			vector<unsigned char> ctrl;  // 7-bit hash fingerprint of each slot
+			vector<uint64_t> codes;      // Full hash code of each slot
+			vector<uint32_t> where;      // Position of each slot's entry in dense
+			int buckets = 0;
+			typename SIZING::Reducer reduce;
+		};
+
+		HASH hasher;        // Seeded per instance
+		uint64_t seed;      // hasher's seed, kept for snapshots
+		StringArena arena;  // Text of every stored entry
+		size_t liveText;    // Bytes of the arena still viewed by entries
+		Table cur;          // Receives every new entry
+		Table old;          // Being drained into cur; no slots when idle
+		int migratePos;     // Every slot of old below this is empty
+		vector<int> swapLog;    // Slots place_new() displaced, for undoing it
+		int numOfElements;  // Over both tables
+		vector<uint64_t> dense;     // Code of every entry, in no order
+		FastRandom rng;             // For random_entry()
+		shared_ptr<const SnapshotFile> snap;   // Mapped snapshot, until the first change
+		typename SIZING::Reducer snapReduce;
+
 		/**
-		 *  Rehash the table into a larger table when the load factor is too large
+		 *  Size t's slot arrays for buckets home buckets, all empty
 		 */
-		vector<list<Word>> lists;
-		int tableSize;
-		int numOfElements;
+		static void allocate(Table & t, int buckets)
+		{
+			t.buckets = buckets;
+			t.reduce = typename SIZING::Reducer(buckets);
+			t.slots.assign(buckets + MAX_PROBE, VALTYPE());
+			t.dists.assign(buckets + MAX_PROBE + HT_GROUP_WIDTH, -1);
+			t.ctrl.assign(buckets + MAX_PROBE + HT_GROUP_WIDTH, 0);
+			t.codes.assign(buckets + MAX_PROBE, 0);
+			t.where.assign(buckets + MAX_PROBE, 0);
+		}
+
+		static void release(Table & t)
+		{
+			t = Table();
+		}
 
+		bool migrating()
+		{
+			return !old.slots.empty();
+		}
+
+		/**
+		 *  Copy the live text into a fresh arena once dead text outweighs it
+		 *   Each compaction follows at least as many dead bytes as it
+		 *   copies, so it costs amortized O(1) per byte stored
+		 */
+		void compact_text()
+		{
+			if(arena.bytes_used() < 2 * liveText + StringArena::BLOCK_SIZE)
+				return;
+			StringArena fresh;
+			for(Table * t : { &cur, &old })
+			{
+				for(size_t i = 0; i < t->slots.size(); i++)
+				{
+					if(t->dists[i] >= 0)
+						intern_into(fresh, t->slots[i]);
+				}
+			}
+			arena = std::move(fresh);
+		}
+
+		/**
+		 *  Start moving into a table twice the size
+		 *   The current table becomes old and is drained by migrate()
+		 */
 		void rehash() 
 		{
-			vector<list<Word>> oldlists=lists;
-			int prime=nextPrime(2*lists.size());
-			lists.resize(prime);
-			for(auto & thisList : lists)
+			finish_migration();
+			old = std::move(cur);
+			migratePos = 0;
+			allocate(cur, SIZING::size_for(old.buckets + 1));
+		}
+
+		/**
+		 *  Move about budget slots of old into cur, whole runs at a time
+		 */
+		void migrate(int budget)
+		{
+			int end = old.slots.size();
+			while(migrating() && budget > 0)
 			{
-				thisList.clear();
+				while(migratePos < end && old.dists[migratePos] < 0 && budget > 0)
+				{
+					migratePos++;
+					budget--;
+				}
+				while(migratePos < end && old.dists[migratePos] >= 0)
+				{
+					place(std::move(old.slots[migratePos]), old.codes[migratePos], old.where[migratePos]);
+					old.slots[migratePos] = VALTYPE();
+					old.dists[migratePos] = -1;
+					migratePos++;
+					budget--;
+				}
+				if(migratePos == end)
+					release(old);
 			}
-			numOfElements=0;
-			tableSize=prime;
-			for(auto & thisList : oldlists)
-			for( auto & x : thisList)
-			insert(x.myword, x);
 		}
 
-		bool isPrime(int n)
+		void finish_migration()
+		{
+			if(migrating())
+				migrate(old.slots.size());
+		}
+
+		/**
+		 *  Rebuild cur at twice the size in one go, leaving old untouched
+		 *   Only for the rare over-long probe run, which may happen in
+		 *   the middle of a migration step
+		 */
+		void grow_cur()
 		{
-			for(int i=2; i<=n/2;i++)
+			Table full = std::move(cur);
+			allocate(cur, SIZING::size_for(full.buckets + 1));
+			for(size_t i = 0; i < full.slots.size(); i++)
 			{
-				if (n%i==0)
-				return false;
+				if(full.dists[i] >= 0)
+					place(std::move(full.slots[i]), full.codes[i], full.where[i]);
 			}
+		}
+
+		/**
+		 *  Robin Hood placement into cur of an entry known not to be present
+		 *   Richer entries (closer to home) give up their slot to poorer ones
+		 *   code is the entry's cached hash, so moving never rehashes a key;
+		 *   at is its position in dense
+		 */
+		void place(VALTYPE val, uint64_t code, uint32_t at)
+		{
+			// Run too long: grow cur right away, then place the evicted entry
+			while(!place_run(val, code, at, nullptr))
+				grow_cur();
+		}
+
+		/**
+		 *  One Robin Hood pass for place() and place_new()
+		 *   Returns false if the run got too long, leaving the entry that
+		 *   was left without a slot in val, code and at; log, if given,
+		 *   gets every slot whose entry was displaced, in order
+		 */
+		bool place_run(VALTYPE & val, uint64_t & code, uint32_t & at, vector<int> * log)
+		{
+			int i = cur.reduce.bucket((uint32_t)code);
+			unsigned char fp = fingerprint(code);
+			signed char dist = 0;
+			while(cur.dists[i] >= 0)
+			{
+				if(cur.dists[i] < dist)
+				{
+					swap(cur.slots[i], val);
+					swap(cur.dists[i], dist);
+					swap(cur.ctrl[i], fp);
+					swap(cur.codes[i], code);
+					swap(cur.where[i], at);
+					if(log != nullptr)
+						log->push_back(i);
+				}
+				i++;
+				dist++;
+				if(dist == MAX_PROBE)
+					return false;
+			}
+			cur.slots[i] = std::move(val);
+			cur.dists[i] = dist;
+			cur.ctrl[i] = fp;
+			cur.codes[i] = code;
+			cur.where[i] = at;
 			return true;
 		}
 
-		int nextPrime(int oldPrime)
+		/**
+		 *  Place a new entry, growing cur at most MAX_GROWTHS times for it
+		 *   Keys whose codes pile onto one bucket (identical low 32 bits
+		 *   are never split by growing) would otherwise grow the table
+		 *   until memory runs out. On failure every displaced entry is
+		 *   put back and false is returned; the table is as it was.
+		 */
+		bool place_new(VALTYPE && val, uint64_t code, uint32_t at)
+		{
+			for(int growths = 0; ; growths++)
+			{
+				swapLog.clear();
+				if(place_run(val, code, at, &swapLog))
+					return true;
+				// Undo the swaps last first, which hands val back the new entry
+				for(size_t k = swapLog.size(); k-- > 0; )
+				{
+					int i = swapLog[k];
+					swap(cur.slots[i], val);
+					swap(cur.codes[i], code);
+					swap(cur.where[i], at);
+					cur.ctrl[i] = fingerprint(cur.codes[i]);
+					cur.dists[i] = i - cur.reduce.bucket((uint32_t)cur.codes[i]);
+				}
+				if(migrating())
+					finish_migration();     // Old entries might be what crowds the run
+				else if(growths < MAX_GROWTHS && load_factor() > MIN_GROW_LOAD)
+					grow_cur();
+				else
+					return false;
+			}
+		}
+
+		/**
+		 *  Probe one group of t's slots starting at base, dist0 from home
+		 *   match: bit j set if slot base+j carries fingerprint fp
+		 *   stop:  bit j set if slot base+j is empty or closer to its home
+		 *          than dist0+j, so the key cannot be at or past it
+		 */
+		static void probe_group(const signed char * dists, const unsigned char * ctrl, int base,
+		                        int dist0, unsigned char fp, unsigned int & match, unsigned int & stop)
+		{
+#if HT_GROUP_WIDTH == 32
+			const __m256i ramp = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			                                      16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+			__m256i d = _mm256_loadu_si256((const __m256i *)&dists[base]);
+			__m256i c = _mm256_loadu_si256((const __m256i *)&ctrl[base]);
+			__m256i want = _mm256_add_epi8(_mm256_set1_epi8((char)dist0), ramp);
+			stop = _mm256_movemask_epi8(_mm256_cmpgt_epi8(want, d));
+			match = _mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8((char)fp)));
+#elif HT_GROUP_WIDTH == 16
+			const __m128i ramp = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+			__m128i d = _mm_loadu_si128((const __m128i *)&dists[base]);
+			__m128i c = _mm_loadu_si128((const __m128i *)&ctrl[base]);
+			__m128i want = _mm_add_epi8(_mm_set1_epi8((char)dist0), ramp);
+			stop = _mm_movemask_epi8(_mm_cmplt_epi8(d, want));
+			match = _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)fp)));
+#else
+			stop = 0;
+			match = 0;
+			for(int j = 0; j < HT_GROUP_WIDTH; j++)
+			{
+				stop |= (unsigned int)(dists[base + j] < dist0 + j) << j;
+				match |= (unsigned int)(ctrl[base + j] == fp) << j;
+			}
+#endif
+		}
+
+		/**
+		 *  First occupied slot of dists at or after i, or n if none is
+		 *   Looks at a group of slots per step; the -1 padding after the
+		 *   last slot keeps every load in bounds
+		 */
+		static size_t next_full(const signed char * dists, size_t i, size_t n)
+		{
+			for(; i < n; i += HT_GROUP_WIDTH)
+			{
+#if HT_GROUP_WIDTH == 32
+				unsigned int full = ~(unsigned int)_mm256_movemask_epi8(
+				                      _mm256_loadu_si256((const __m256i *)&dists[i]));
+#elif HT_GROUP_WIDTH == 16
+				unsigned int full = ~(unsigned int)_mm_movemask_epi8(
+				                      _mm_loadu_si128((const __m128i *)&dists[i])) & 0xFFFFu;
+#else
+				unsigned int full = 0;
+				for(int j = 0; j < HT_GROUP_WIDTH; j++)
+					full |= (unsigned int)(dists[i + j] >= 0) << j;
+#endif
+				if(full)
+					return min(i + __builtin_ctz(full), n);
+			}
+			return n;
+		}
+
+		/**
+		 *  Distances of the slots iterators walk: part 0 is the snapshot
+		 *   or cur, part 1 is old
+		 */
+		const signed char * part_dists(int part, size_t & n) const
+		{
+			if(part == 0 && snap)
+			{
+				n = snap->header().slots;
+				return snap->dists();
+			}
+			const Table & t = part == 0 ? cur : old;
+			n = t.slots.size();
+			return t.dists.data();
+		}
+
+		/**
+		 *  Slot holding the entry with this code for which same(slot) holds,
+		 *   or -1 if absent; works on a table's arrays wherever they live
+		 *   Distances stay under MAX_PROBE, so a group reaching that far
+		 *   always has a stop bit and the loop ends inside the padding.
+		 */
+		template <typename SAME>
+		static int probe(const signed char * dists, const unsigned char * ctrl, const uint64_t * codes,
+		                 const typename SIZING::Reducer & reduce, uint64_t code, SAME same)
+		{
+			int base = reduce.bucket((uint32_t)code);
+			unsigned char fp = fingerprint(code);
+			for(int dist0 = 0; ; base += HT_GROUP_WIDTH, dist0 += HT_GROUP_WIDTH)
+			{
+				unsigned int match, stop;
+				probe_group(dists, ctrl, base, dist0, fp, match, stop);
+				if(stop)
+					match &= (stop & (0u - stop)) - 1;   // Only slots before the first stop
+				while(match)
+				{
+					int j = __builtin_ctz(match);
+					if(codes[base + j] == code && same(base + j))
+						return base + j;
+					match &= match - 1;
+				}
+				if(stop)
+					return -1;
+			}
+		}
+
+		/**
+		 *  Slot of t holding key, or -1 if absent
+		 */
+		static int find_slot(const Table & t, uint64_t code, LOOKUP key)
+		{
+			if(t.buckets == 0)
+				return -1;
+			return probe(t.dists.data(), t.ctrl.data(), t.codes.data(), t.reduce, code,
+			             [&](int i) { return t.slots[i].myword == key; });
+		}
+
+		/**
+		 *  Entry for key in either table, or nullptr
+		 *   Not for a mapped snapshot, which has to be thawed first
+		 */
+		VALTYPE * lookup(uint64_t code, LOOKUP key)
+		{
+			int i = find_slot(cur, code, key);
+			if(i >= 0)
+				return &cur.slots[i];
+			i = find_slot(old, code, key);
+			return i >= 0 ? &old.slots[i] : nullptr;
+		}
+
+		/**
+		 *  Slot of the mapped snapshot holding key, or -1
+		 */
+		int snapshot_slot(uint64_t code, LOOKUP key) const
+		{
+			const SnapshotFile & file = *snap;
+			return probe(file.dists(), file.ctrl(), file.codes(), snapReduce, code,
+			             [&](int j) { return file.word(j) == key; });
+		}
+
+		/**
+		 *  Copy the mapped snapshot into cur and its text into the arena
+		 *   The arrays are taken as they are; no key is hashed again
+		 */
+		void thaw()
 		{
-			int nextPrime=oldPrime;
-			bool found=false;
-			while(!found)
+			if(!snap)
+				return;
+			shared_ptr<const SnapshotFile> file = std::move(snap);
+			snap.reset();
+			const SnapshotHeader & h = file->header();
+			release(old);
+			allocate(cur, h.buckets);
+			memcpy(cur.dists.data(), file->dists(), h.slots);
+			memcpy(cur.ctrl.data(), file->ctrl(), h.slots);
+			memcpy(cur.codes.data(), file->codes(), h.slots * sizeof(uint64_t));
+			for(size_t i = 0; i < h.slots; i++)
 			{
-				nextPrime++;
-				if(isPrime(nextPrime))
+				if(cur.dists[i] < 0)
+					continue;
+				cur.slots[i] = VALTYPE(file->word(i), file->definition(i));
+				intern_into(arena, cur.slots[i]);
+			}
+			liveText = arena.bytes_used();
+			rebuild_dense();
+			numOfElements = dense.size();   // Unless verified, the header's count was taken on trust
+		}
+
+		/**
+		 *  Slot of t holding the entry with this code at position at of
+		 *   dense, or -1
+		 */
+		static int find_dense(const Table & t, uint64_t code, uint32_t at)
+		{
+			if(t.buckets == 0)
+				return -1;
+			return probe(t.dists.data(), t.ctrl.data(), t.codes.data(), t.reduce, code,
+			             [&](int i) { return t.where[i] == at; });
+		}
+
+		/**
+		 *  Remove position at from dense by moving the last code into it
+		 */
+		void drop_dense(uint32_t at)
+		{
+			uint32_t last = dense.size() - 1;
+			if(at != last)
+			{
+				uint64_t code = dense[last];
+				dense[at] = code;
+				int i = find_dense(cur, code, last);
+				if(i >= 0)
+					cur.where[i] = at;
+				else
+					old.where[find_dense(old, code, last)] = at;
+			}
+			dense.pop_back();
+		}
+
+		/**
+		 *  Number every entry afresh, after changes too big to track one by one
+		 */
+		void rebuild_dense()
+		{
+			dense.clear();
+			for(Table * t : { &cur, &old })
+			{
+				for(size_t i = 0; i < t->slots.size(); i++)
 				{
-					found=true;
+					if(t->dists[i] < 0)
+						continue;
+					t->where[i] = dense.size();
+					dense.push_back(t->codes[i]);
 				}
 			}
-			return nextPrime;
 		}
 
 		/**
-		 *  Function that takes the key (a string or int) and returns the hash key
-		 *   This function needs to be implemented for several types it could be used with!
+		 *  Empty slot i of t, pulling the rest of its run one slot closer to home
 		 */
-		int hash_function(int key) {
-			return key%tableSize;
+		static void erase_slot(Table & t, int i)
+		{
+			int last = t.slots.size() - 1;
+			while(i < last && t.dists[i + 1] > 0)
+			{
+				t.slots[i] = std::move(t.slots[i + 1]);
+				t.dists[i] = t.dists[i + 1] - 1;
+				t.ctrl[i] = t.ctrl[i + 1];
+				t.codes[i] = t.codes[i + 1];
+				t.where[i] = t.where[i + 1];
+				i++;
+			}
+			t.slots[i] = VALTYPE();
+			t.dists[i] = -1;
+			t.ctrl[i] = 0;
+			t.codes[i] = 0;
 		}
 
-		int hash_function(string key) {
-			unsigned int hashval=0;
-			for(char ch : key)
+		/**
+		 *  Empty every slot of t marked in doomed and close the gaps in
+		 *   one left-to-right pass
+		 *   Each survivor moves back to its home or to just past the one
+		 *   before it, whichever is further on. Order within runs is kept,
+		 *   so this ends as removing them one at a time would.
+		 */
+		static void sweep(Table & t, const vector<char> & doomed)
+		{
+			int next = 0;   // First slot not taken by an earlier survivor
+			for(int i = 0; i < (int)t.slots.size(); i++)
+			{
+				if(t.dists[i] < 0)
+					continue;
+				if(doomed[i])
+				{
+					t.slots[i] = VALTYPE();
+					t.dists[i] = -1;
+					t.ctrl[i] = 0;
+					t.codes[i] = 0;
+					continue;
+				}
+				int home = i - t.dists[i];
+				int to = max(home, next);
+				if(to != i)
+				{
+					t.slots[to] = std::move(t.slots[i]);
+					t.dists[to] = to - home;
+					t.ctrl[to] = t.ctrl[i];
+					t.codes[to] = t.codes[i];
+					t.where[to] = t.where[i];
+					t.slots[i] = VALTYPE();
+					t.dists[i] = -1;
+					t.ctrl[i] = 0;
+					t.codes[i] = 0;
+				}
+				next = to + 1;
+			}
+		}
+
+		/**
+		 *  Insert or replace val under key; val is only moved from once
+		 *   the lookup is done, so key may point into val itself
+		 *   val's text is copied into the arena first, so it may view
+		 *   the caller's temporaries
+		 *   key is already in normal form; val is stored under it
+		 */
+		bool insert_value(LOOKUP key, VALTYPE && val)
+		{
+			thaw();
+			uint64_t code = hash_code(key);
+			if constexpr (!KEYS::IDENTITY && is_same<KEYTYPE, string>::value)
+				val.myword = key;
+			intern_into(arena, val);
+			bool stored = store(code, std::move(val));
+			compact_text();
+			return stored;
+		}
+
+		/**
+		 *  Add val, its text already in the arena and its key already
+		 *   hashed to code, replacing any entry with the same key
+		 *   Returns false if a new key's probe run cannot be made short
+		 *   enough (see place_new); nothing is stored then
+		 *   Never compacts, so other entries' text may still be pending
+		 */
+		bool store(uint64_t code, VALTYPE && val)
+		{
+			liveText += text_bytes(val);
+			VALTYPE * found = lookup(code, val.myword);
+			if(found != nullptr)
+			{
+				liveText -= text_bytes(*found);
+				*found = std::move(val);
+				return true;
+			}
+			numOfElements++;
+			if(load_factor() > MAX_LOAD)
 			{
-				hashval=37*hashval+ch;
+				rehash();
 			}
-			return hashval % tableSize;
+			dense.push_back(code);
+			if(!place_new(std::move(val), code, dense.size() - 1))
+			{
+				dense.pop_back();
+				numOfElements--;
+				liveText -= text_bytes(val);
+				return false;
+			}
+			migrate(MIGRATE_SLOTS);
+			return true;
+		}
 
+		/**
+		 *  Function that takes the key (a string or int) and returns the hash code
+		 *   Buckets come from its low 32 bits via the SIZING reducer,
+		 *   fingerprints from the top of a multiplicative mix of all 64
+		 */
+		uint64_t hash_code(LOOKUP key) {
+			return hasher(key);
+		}
+
+		static unsigned char fingerprint(uint64_t code) {
+			return (code * 0x9E3779B97F4A7C15ull) >> 57;
 		}
 
 		 
 	public:
 		/**
 		 *  Basic constructor
+		 *   startingSize is rounded up to a size the SIZING policy supports
+		 *   The hash gets a fresh random seed unless one is given
 		 */
-		Hashtable( int startingSize = 101 )
+		Hashtable( int startingSize = 101, uint64_t theSeed = fresh_hash_seed() )
+		  : hasher(theSeed), seed(theSeed), rng(theSeed ^ 0x9E3779B97F4A7C15ull)
 		{
 			numOfElements = 0;
-			tableSize = startingSize;
-			lists.resize(101);
+			liveText = 0;
+			migratePos = 0;
+			swapLog.reserve(MAX_PROBE);
+			allocate(cur, SIZING::size_for(startingSize));
 		}
 
 		/**
 		 *  Add an element to the hash table
+		 *   An existing entry for key is replaced
+		 *   val is a sink: pass an rvalue to move it all the way into its slot
+		 *   Returns false, storing nothing, if too many keys share key's
+		 *   hash for its probe run to fit
 		 */
-		bool insert(KEYTYPE key, VALTYPE val) {
-			 int index = hash_function(key);
-			 bool IsInList=false;
-			 // if item is not in the list
-			 // hash the key to determine which bucket the key would be stored in.
-			if( !lists[index].empty())
-			{
-				for(auto item : lists[index])// item takes on each successive element of list on that index
-			 							//at list[index] an object is stored and item is an object here
-			 {
-
-				 if(item.myword == key ) //if the same word/key is found then replace the definition
-				 {
-					 item.definition=val.definition;
-					 return true;
-				 }
-				
-			 }
-			}				
-				 lists[index].push_back(val);
-				 numOfElements++;
-				 if(load_factor()>1.0)
-				 {
-					 rehash();
-				 }
-				 return true;
-				 
-			 
-			 //if item is in the list
+		bool insert(LOOKUP key, VALTYPE val) {
+			NORMAL normal(key);
+			return insert_value(normal.view(), std::move(val));
 		}
 
 		/**
-		 *  Return whether a given key is present in the hash table
+		 *  Build a VALTYPE from args and insert it under its own myword
 		 */
-		bool contains(KEYTYPE key) {
-			int index=hash_function(key);
-			if(!lists.empty())
-			{
-			 for(auto item : lists[index])// item takes on each successive element of list on that index
-			 							//at list[index] an object is stored and item is an object here
-			 {
-
-				 if(item.myword == key ) //if the same word/key is found then replace the definition
-				 {
-					 return true;
-				 }
-				
-			 }
-			}
+		template <typename... ARGS>
+		bool emplace(ARGS &&... args) {
+			VALTYPE val(std::forward<ARGS>(args)...);
+			NORMAL normal(val.myword);
+			return insert_value(normal.view(), std::move(val));
+		}
 
-			return false;
-			 
+		/**
+		 *  Return whether a given key is present in the hash table
+		 */
+		bool contains(LOOKUP key) {
+			NORMAL normal(key);
+			if(snap)
+				return snapshot_slot(hash_code(normal.view()), normal.view()) >= 0;
+			return lookup(hash_code(normal.view()), normal.view()) != nullptr;
 		}
 
 
@@ -176,52 +1045,217 @@ class Hashtable
 		 *  Completely remove key from hash table
 		 *   Returns number of elements removed
 		 */
-		int remove(KEYTYPE key) {
-			// Doesn't actually remove anything yet
-			int index=hash_function(key);
-			for(unsigned int i = 0; i < key.length(); i++)
-			key[i] = toupper(key[i]);
-
-			if(!empty())
+		int remove(LOOKUP name) {
+			thaw();
+			NORMAL normal(name);
+			LOOKUP key = normal.view();
+			uint64_t code=hash_code(key);
+			Table * t = &cur;
+			int i = find_slot(cur, code, key);
+			if(i < 0 && (i = find_slot(old, code, key)) >= 0)
+				t = &old;
+			if(i < 0)
+				return 0;
+			uint32_t at = t->where[i];
+			liveText -= text_bytes(t->slots[i]);
+			erase_slot(*t, i);
+			drop_dense(at);
+			numOfElements--;
+			migrate(MIGRATE_SLOTS);
+			compact_text();
+			return 1;
+		}
+		/**
+		 *  Remove every key in [first, last)
+		 *   Returns number of elements removed; repeated keys count once
+		 *   Big batches only mark their slots while looking keys up, then
+		 *   close every gap in one sweep over the table instead of
+		 *   shifting a run back once per key.
+		 */
+		template <typename ITER>
+		int remove_all(ITER first, ITER last) {
+			thaw();
+			size_t n = distance(first, last);
+			int removed = 0;
+			if(n < (cur.slots.size() + old.slots.size()) / SWEEP_RATIO)
 			{
-			 for(auto item : lists[index])// item takes on each successive element of list on that index
-			 							//at list[index] an object is stored and item is an object here
-			 {
-
-				 if(item.myword == key ) //if the same word/key is found then replace the definition
-				 {
-					 lists[index].remove(item);
-					 numOfElements--;
-					 return 1;
-				 }
-				
-			 }
-			 return 0;
+				for(; first != last; ++first)
+					removed += remove(*first);
+				return removed;
+			}
+			finish_migration();
+			vector<char> doomed(cur.slots.size(), 0);
+			for(; first != last; ++first)
+			{
+				NORMAL normal(*first);
+				int i = find_slot(cur, hash_code(normal.view()), normal.view());
+				if(i >= 0 && !doomed[i])
+				{
+					doomed[i] = 1;
+					liveText -= text_bytes(cur.slots[i]);
+					removed++;
+				}
 			}
-			cout<<"List is Empty\n";
+			sweep(cur, doomed);
+			rebuild_dense();
+			numOfElements -= removed;
+			compact_text();
+			return removed;
 		}
+
 		/**
 		 *  Searches the hash and returns a pointer
 		 *   Pointer to Word if found, or nullptr if nothing matches
+		 *   Points at the entry itself, so writes through it stick; only
+		 *   valid until the next change to the table. A mapped snapshot
+		 *   is copied out first; find(key, out) leaves it mapped.
 		 */
-		VALTYPE *find(KEYTYPE key) {
-			int index=hash_function(key);
-			if(!empty())
-			{
-			 for(auto &item : lists[index])// item takes on each successive element of list on that index
-			 							//at list[index] an object is stored and item is an object here
-			 {
+		VALTYPE *find(LOOKUP key) {
+			thaw();
+			NORMAL normal(key);
+			return lookup(hash_code(normal.view()), normal.view());
+		}
 
-				 if(item.myword == key ) //if the same word/key is found then replace the definition
-				 {
-					 return &item;
-				 }
-				
-			 }
-			 
+		/**
+		 *  Copy key's entry into out; returns false if it is not there
+		 *   The copy views the table's text, so it stays valid until the
+		 *   next change to the table
+		 */
+		bool find(LOOKUP key, VALTYPE & out) {
+			NORMAL normal(key);
+			uint64_t code = hash_code(normal.view());
+			if(snap)
+			{
+				int i = snapshot_slot(code, normal.view());
+				if(i >= 0)
+					out = VALTYPE(snap->word(i), snap->definition(i));
+				return i >= 0;
 			}
-			return nullptr;
-			
+			const VALTYPE * found = lookup(code, normal.view());
+			if(found != nullptr)
+				out = *found;
+			return found != nullptr;
+		}
+
+		/**
+		 *  Forward iterator over every entry, in slot order
+		 *   Entries are read only; any change to the table invalidates it.
+		 *   Over a mapped snapshot it holds a VALTYPE viewing the file.
+		 */
+		class iterator
+		{
+			public:
+				typedef forward_iterator_tag iterator_category;
+				typedef VALTYPE value_type;
+				typedef ptrdiff_t difference_type;
+				typedef const VALTYPE * pointer;
+				typedef const VALTYPE & reference;
+
+				iterator() : table(nullptr), part(2), at(0) { }
+
+				const VALTYPE & operator*() const
+				{
+					if(part == 0 && table->snap)
+						return mapped;
+					return (part == 0 ? table->cur : table->old).slots[at];
+				}
+
+				const VALTYPE * operator->() const
+				{
+					return &**this;
+				}
+
+				iterator & operator++()
+				{
+					at++;
+					settle();
+					return *this;
+				}
+
+				iterator operator++(int)
+				{
+					iterator before = *this;
+					++*this;
+					return before;
+				}
+
+				bool operator==(const iterator & o) const
+				{
+					return part == o.part && at == o.at;
+				}
+
+				bool operator!=(const iterator & o) const
+				{
+					return !(*this == o);
+				}
+
+			private:
+				friend class Hashtable;
+
+				const Hashtable * table;
+				int part;           // 0: snapshot or cur, 1: old, 2: end
+				size_t at;          // Slot within part
+				VALTYPE mapped;     // Entry at a snapshot slot
+
+				iterator(const Hashtable * theTable) : table(theTable), part(0), at(0)
+				{
+					settle();
+				}
+
+				/**
+				 *  Move to the first entry at or after at, or to end
+				 */
+				void settle()
+				{
+					for(; part < 2; part++, at = 0)
+					{
+						size_t n;
+						const signed char * dists = table->part_dists(part, n);
+						at = next_full(dists, at, n);
+						if(at < n)
+						{
+							if(part == 0 && table->snap)
+								mapped = VALTYPE(table->snap->word(at), table->snap->definition(at));
+							return;
+						}
+					}
+					at = 0;
+				}
+		};
+
+		iterator begin() {
+			return iterator(this);
+		}
+
+		iterator end() {
+			return iterator();
+		}
+
+		/**
+		 *  Call f(entry) for every entry, in slot order
+		 *   f must not change the table
+		 */
+		template <typename FUNC>
+		void for_each(FUNC && f) {
+			for(const VALTYPE & v : *this)
+				f(v);
+		}
+
+		/**
+		 *  Make room for n elements without growing again
+		 *   Finishes any migration in progress and moves everything at once
+		 */
+		void reserve(int n) {
+			thaw();
+			dense.reserve(n);
+			int needed = (int)(n / MAX_LOAD) + 1;
+			if(needed <= cur.buckets)
+				return;
+			finish_migration();
+			old = std::move(cur);
+			migratePos = 0;
+			allocate(cur, SIZING::size_for(needed));
+			finish_migration();
 		}
 
 		/**
@@ -246,223 +1280,317 @@ class Hashtable
 		 */
 		float load_factor() {
 			//return _hash.load_factor();
-			return (float)numOfElements/(float)tableSize;
+			return (float)numOfElements/(float)bucket_count();
 		}
 
 		/**
-		 *  Returns current number of buckets (elements in vector)
+		 *  Returns current number of buckets (home slots in the table)
 		 */
 		int bucket_count() {
-			return tableSize;
+			if(snap)
+				return snap->header().buckets;
+			return cur.buckets;
+		}
+
+		/**
+		 *  Bytes of entry text held in the arena, including text of
+		 *   removed entries not yet compacted away
+		 */
+		size_t arena_bytes() {
+			return arena.bytes_used();
 		}
 
 		/**
 		 *  Deletes all elements in the hash
+		 *   Their text goes with the arena's blocks in one step
 		 */
 		void clear() {
-			// Does nothing yet
-			for(auto & thisList : lists)
-			{
-				thisList.clear();
-			}
+			snap.reset();
+			release(old);
+			fill(cur.slots.begin(), cur.slots.end(), VALTYPE());
+			fill(cur.dists.begin(), cur.dists.end(), -1);
+			fill(cur.ctrl.begin(), cur.ctrl.end(), 0);
 			numOfElements=0;
+			dense.clear();
+			arena.clear();
+			liveText = 0;
 		}
 
 
-		void load(string filename)
+		/**
+		 *  Add every entry of a dictionary JSON file, or of a snapshot
+		 *   written by save()
+		 *   The file is mapped and parsed in one pass; words and
+		 *   definitions go from the mapping straight into the arena.
+		 *   With threads > 1 the structural scan is split over that many
+		 *   threads; entries still go in in file order, so the table
+		 *   ends up the same whatever the thread count.
+		 */
+		void load(string filename, int threads = 1)
 		{
-		ifstream myfile;
-		//filename='"'+filename+'"';
-		string line,temp;
-		string tempWord, tempDef;
-		int found, curly,square;
-		myfile.open(filename.c_str()); // this in_stream (fstream) the "filename" to open.
-		if (!myfile.is_open())
+			if(SnapshotFile::is_snapshot(filename))
+			{
+				load_snapshot(filename);
+				return;
+			}
+			MappedFile file(filename);
+			if(!file.is_open())
+			{
+				cout << "Could not open file to read.""\n"; // if the open file fails.
+				return;
+			}
+			size_t errorAt;
+			bool ok;
+			if(threads <= 1)
+			{
+				ok = for_each_dict_entry(file.text(), 1, [this](string_view word, string_view def) {
+					emplace(word, def);
+				}, errorAt);
+			}
+			else
+			{
+				// Each part of the file goes into a table of its own, on its
+				// own thread, hashed with this table's seed. The parts are
+				// then stored in file order with no presizing, the same
+				// inserts a sequential load makes, so the layout, and with
+				// it print's order, does not depend on the thread count
+				vector<unique_ptr<Hashtable> > parts;
+				for(int i = 0; i < threads + 2; i++)
+					parts.emplace_back(new Hashtable(101, seed));
+				int used;
+				ok = for_each_dict_part(file.text(), threads, [&parts](int part, string_view word, string_view def) {
+					parts[part]->emplace(word, def);
+				}, used, errorAt);
+				for(int i = 0; i < used; i++)
+					absorb(std::move(*parts[i]));
+			}
+			if(!ok)
+				cout << "Malformed JSON in " << filename << " at byte " << errorAt << "\n";
+		}
+
+		/**
+		 *  Move every entry of part, a table with the same seed, into this
+		 *   one, replacing entries with the same key
+		 *   Entries go in part's dense order, which is the order their
+		 *   keys were first added if nothing was removed from part.
+		 *   Cached codes are reused and part's arena is taken over whole,
+		 *   so no key is hashed or copied again; part is left empty
+		 */
+		void absorb(Hashtable && part)
 		{
-			cout << "Could not open file to read.""\n"; // if the open file fails.
-			return;
+			thaw();
+			part.thaw();
+			arena.adopt(std::move(part.arena));
+			for(uint32_t at = 0; at < part.dense.size(); at++)
+			{
+				uint64_t code = part.dense[at];
+				Table * t = &part.cur;
+				int i = find_dense(part.cur, code, at);
+				if(i < 0)
+				{
+					t = &part.old;
+					i = find_dense(part.old, code, at);
+				}
+				store(code, std::move(t->slots[i]));
+			}
+			part.clear();
+			compact_text();
 		}
-		else
+
+		/**
+		 *  Add or adopt the snapshot in filename
+		 *   An empty table takes the file over as it is, in constant time;
+		 *   otherwise its entries are added one by one. verify also
+		 *   checks the body checksum, which reads the whole file.
+		 */
+		void load_snapshot(const string & filename, bool verify = false)
 		{
-			getline(myfile, line);
-			getline(myfile, line);
-			while(!myfile.eof()) 
+			shared_ptr<const SnapshotFile> file = make_shared<const SnapshotFile>(filename);
+			string problem = file->check(verify);
+			const SnapshotHeader & h = file->header();
+			if(problem.empty())
+			{
+				HASH theirs(h.seed);
+				typename SIZING::Reducer reduce(h.buckets);
+				if((theirs(string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) ^ KEYS::ID) != h.hashCheck)
+					problem = "written with another hash or key policy";
+				else if(h.buckets == 0 || h.buckets > (1u << 30) || SIZING::size_for(h.buckets) != (int)h.buckets
+				        || h.slots != h.buckets + MAX_PROBE || (uint64_t)reduce.bucket(0x9E3779B9u) != h.bucketCheck)
+					problem = "written with another bucket sizing";
+			}
+			if(!problem.empty())
+			{
+				cout << "Bad snapshot " << filename << ": " << problem << "\n";
+				return;
+			}
+			if(!empty() || snap)
 			{
-				
-				getline(myfile, line);
-				curly=line.find('}'); //find first quote : word
-				square=line.find(']'); //find first quote : word
-				
-				if (curly>8  || square>8)
+				for(size_t i = 0; i < h.slots; i++)
 				{
-				found=line.find('\"'); //find first quote : word
-				temp=line.substr(found+1,line.length());
-				found=temp.find('\"');//find second quote : word
-				temp=temp.substr(found+1,line.length());
-
-				found=temp.find('\"'); //find first quote : myWord
-				temp=temp.substr(found+1,line.length());
-				found=temp.find('\"'); //find seond quote : word
-				tempWord=temp.substr(0,found);
-				temp=temp.substr(found+1,line.length());
-				
-				found=temp.find('\"'); //find first quote : definition
-				temp=temp.substr(found+1,temp.length()); 
-				found=temp.find('\"'); //find second quote : definition
-				temp=temp.substr(found+1,temp.length()); 
-				
-				found=temp.find('\"'); //find first quote : myDef
-				temp=temp.substr(found+1,temp.length());
-				found=temp.find('\"'); //find seond quote : myDef
-				tempDef=temp.substr(0,found);
-				
-				Word myWord(tempWord, tempDef);
-				insert(tempWord,myWord);
-				}}
-		
-		
+					if(file->dists()[i] >= 0)
+						emplace(file->word(i), file->definition(i));
+				}
+				return;
+			}
+			release(old);
+			arena.clear();
+			liveText = 0;
+			dense.clear();
+			seed = h.seed;
+			hasher = HASH(seed);
+			snapReduce = typename SIZING::Reducer(h.buckets);
+			numOfElements = h.count;
+			snap = file;
 		}
-		myfile.close();
 
-	}
-	void unload(string filename)
-	{
-	ifstream myfile2;
-	//filename='"'+filename+'"';
-	string line,temp;
-	string tempWord, tempDef;
-	int found;
-	myfile2.open(filename.c_str()); // this in_stream (fstream) the "filename" to open.
-	if (!myfile2.is_open())
-	{
-		cout << "Could not open file to read.""\n"; // if the open file fails.
-		return;
-	}
-	else
-	{
-		getline(myfile2, line);
-		getline(myfile2, line);
-		while(!myfile2.eof()) 
+		/**
+		 *  Write the table as a binary snapshot for load() to map back in
+		 *   Any migration in progress is finished first
+		 */
+		bool save(string filename)
 		{
-			
-			getline(myfile2, line);
-			found=line.find('\"'); //find first quote : word
-			temp=line.substr(found+1,line.length());
-			found=temp.find('\"');//find second quote : word
-			temp=temp.substr(found+1,line.length());
-
-			found=temp.find('\"'); //find first quote : myWord
-			temp=temp.substr(found+1,line.length());
-			found=temp.find('\"'); //find seond quote : word
-			tempWord=temp.substr(0,found);
-			temp=temp.substr(found+1,line.length());
-			
-			found=temp.find('\"'); //find first quote : definition
-			temp=temp.substr(found+1,temp.length()); 
-			found=temp.find('\"'); //find second quote : definition
-			temp=temp.substr(found+1,temp.length()); 
-			
-			found=temp.find('\"'); //find first quote : myDef
-			temp=temp.substr(found+1,temp.length());
-			found=temp.find('\"'); //find seond quote : myDef
-			tempDef=temp.substr(0,found);
-			
-			Word myWord(tempWord, tempDef);
-			remove(tempWord);
-			
+			thaw();
+			finish_migration();
+			SnapshotHeader h = SnapshotHeader();
+			h.seed = seed;
+			h.hashCheck = hasher(string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) ^ KEYS::ID;
+			h.bucketCheck = cur.reduce.bucket(0x9E3779B9u);
+			h.count = numOfElements;
+			h.buckets = cur.buckets;
+			h.slots = cur.slots.size();
+			vector<SnapshotEntry> entries(h.slots, SnapshotEntry());
+			string pool;
+			for(size_t i = 0; i < h.slots; i++)
+			{
+				if(cur.dists[i] < 0)
+					continue;
+				const VALTYPE & v = cur.slots[i];
+				entries[i].word = pool.size();
+				entries[i].wordBytes = v.myword.size();
+				pool.append(v.myword.data(), v.myword.size());
+				entries[i].definition = pool.size();
+				entries[i].definitionBytes = v.definition.size();
+				pool.append(v.definition.data(), v.definition.size());
+			}
+			if(!write_snapshot(filename, h, cur.dists.data(), cur.ctrl.data(), cur.codes.data(), entries, pool))
+			{
+				cout << "Could not open file to write.""\n";
+				return false;
+			}
+			return true;
 		}
-	
-	}
-	myfile2.close();
-}
-		void print(int num )
+
+		/**
+		 *  Remove every word listed in a dictionary JSON file
+		 *   The words are gathered first and removed as one batch
+		 *   Returns number of elements removed
+		 */
+		int unload(string filename, int threads = 1)
 		{
-			if(num==0)
+			MappedFile file(filename);
+			if(!file.is_open())
 			{
-			
-				int i=0;
-				int j=0;
-				if(!lists.empty())
-				{
-					for (int i=0; i< tableSize ; i++)
-					{
-						
-						for (auto item: lists[i])
-							{
-							cout<<item.myword<<endl;
-							j++;
-							}
-						
-					}
-				}
+				cout << "Could not open file to read.""\n"; // if the open file fails.
+				return 0;
 			}
-			else
+			string_view text = file.text();
+			vector<string_view> words;
+			StringArena decoded;    // Words with escapes outlive the parser's scratch
+			size_t errorAt;
+			bool ok = for_each_dict_entry(text, threads, [&](string_view word, string_view) {
+				bool inside = word.data() >= text.data() && word.data() + word.size() <= text.data() + text.size();
+				words.push_back(inside ? word : decoded.copy(word));
+			}, errorAt);
+			if(!ok)
+				cout << "Malformed JSON in " << filename << " at byte " << errorAt << "\n";
+			return remove_all(words.begin(), words.end());
+		}
+
+		/**
+		 *  Print the first num words, or every word if num is 0
+		 *   Output goes out in large blocks, flushed once at the end
+		 */
+		void print(int num, ostream & out = cout)
+		{
+			BlockWriter writer(out);
+			int j = 0;
+			for (iterator it = begin(); it != end(); ++it)
 			{
-				int i=0;
-				int j=0;
-				if(!lists.empty())
-				{
-					for (int i=0; i< tableSize ; i++)
-					{
-						
-						for (auto item: lists[i])
-							{
-							if (j>=num)
-							return;
-							cout<<item.myword<<endl;
-							j++;
-							}
-						
-					}
-				}
+				writer.line(it->myword);
+				if(num > 0 && ++j == num)
+					break;    // Before ++it, which would scan on to the next entry
 			}
-			
-	
 		}
-		void define(string word)
+		/**
+		 *  Print word's definition; returns false if it is not there
+		 */
+		bool define(string_view word)
 		{
-			for(unsigned int i = 0; i < word.length(); i++)
-			  word[i] = toupper(word[i]);
-			  int hash_key=hash_function(word);
-			if(!lists.empty())
+			VALTYPE item;
+			if(find(word, item))
 			{
+				cout<<item.definition<<endl;
+				return true;
+			}
+			return false;
+		}
+		/**
+		 *  A uniformly random entry in O(1), or nullptr if empty
+		 *   Like find(), copies a mapped snapshot out first; only valid
+		 *   until the next change to the table
+		 */
+		VALTYPE * random_entry()
+		{
+			thaw();
+			if(dense.empty())
+				return nullptr;
+			uint32_t at = rng.below(dense.size());
+			int i = find_dense(cur, dense[at], at);
+			if(i >= 0)
+				return &cur.slots[i];
+			return &old.slots[find_dense(old, dense[at], at)];
+		}
 
-					
-					for (auto item: lists[hash_key])
-						{
-						if(item.myword==word)
-						{
-							cout<<item.definition<<endl;
-						break;
-					}
-						
+		/**
+		 *  Copy a uniformly random entry into out; returns false if empty
+		 *   A mapped snapshot stays mapped: its slots are sampled until
+		 *   one is occupied
+		 */
+		bool random_entry(VALTYPE & out)
+		{
+			if(!snap)
+			{
+				const VALTYPE * item = random_entry();
+				if(item != nullptr)
+					out = *item;
+				return item != nullptr;
+			}
+			if(empty())
+				return false;
+			// An unverified header count can be wrong, so the misses are
+			// capped, far above what a true count needs, before giving up
+			// on sampling and copying the snapshot out
+			const SnapshotHeader & h = snap->header();
+			uint64_t tries = 16 * (h.slots / h.count + 1);
+			while(tries-- > 0)
+			{
+				size_t i = rng.below(h.slots);
+				if(snap->dists()[i] >= 0)
+				{
+					out = VALTYPE(snap->word(i), snap->definition(i));
+					return true;
 				}
-					
-				
 			}
+			thaw();
+			return random_entry(out);
 		}
+
 		void randomPrint()
 		{
-			int key,index;
-			while(true)
-			{
-			
-			 key = (rand ()% lists.size())+1;
-			index=hash_function(key);
-			if(!lists[index].empty())
-			{
-			 for(auto &item : lists[index])// item takes on each successive element of list on that index
-			 							//at list[index] an object is stored and item is an object here
-			 {
+			VALTYPE item;
+			if(random_entry(item))
 				cout<< "Random word generated is: "<<item.myword<<endl;
-				return;
-				 
-				
-			 }
-			}
-			
 		}
-	}
 
 };
 
@@ -0,0 +1,258 @@
+/**
+ *  keynorm.h - Key normalization policies for case-insensitive tables
+ *
+ */
+
+#ifndef __KEY_NORM_H
+#define __KEY_NORM_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+
+#if !defined(HT_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#elif !defined(HT_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/*
+ *  Key policies: how a table turns a key into the form it stores,
+ *  hashes and compares
+ *   static const bool IDENTITY          --> keys are used exactly as given
+ *   static const uint64_t ID            --> tells policies apart in snapshots
+ *   static void normalize(in, n, out)   --> write the n-byte normal form of in
+ *                                           to out; always n bytes
+ *  Normal forms keep the key's length, so a lookup can normalize into a
+ *  buffer on the stack and then hash and compare with plain byte
+ *  operations against keys that were normalized when they were stored.
+ */
+
+/**
+ *  Uppercase the ASCII letters of in[0, n) into out; other bytes are
+ *   copied unchanged. 32 (AVX2) or 16 (SSE2) bytes per step, then eight
+ *   at a time in a 64-bit word, then byte by byte.
+ */
+inline void ascii_toupper(const char * in, size_t n, char * out)
+{
+	size_t i = 0;
+#if !defined(HT_NO_SIMD) && defined(__AVX2__)
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i c = _mm256_loadu_si256((const __m256i *)(in + i));
+		// Bytes of 0x80 and up are negative, so they fall outside 'a'..'z'
+		__m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+		                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+		c = _mm256_sub_epi8(c, _mm256_and_si256(lower, _mm256_set1_epi8(0x20)));
+		_mm256_storeu_si256((__m256i *)(out + i), c);
+	}
+#elif !defined(HT_NO_SIMD) && defined(__SSE2__)
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+		                              _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+		c = _mm_sub_epi8(c, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+		_mm_storeu_si128((__m128i *)(out + i), c);
+	}
+#endif
+	const uint64_t ones = 0x0101010101010101ull;
+	for(; i + 8 <= n; i += 8)
+	{
+		// High bit of each byte: at least 'a', above 'z', and ASCII at all
+		uint64_t w;
+		memcpy(&w, in + i, 8);
+		uint64_t low7 = w & (0x7F * ones);
+		uint64_t atLeastA = low7 + (0x80 - 'a') * ones;
+		uint64_t aboveZ = low7 + (0x80 - 'z' - 1) * ones;
+		uint64_t lower = atLeastA & ~aboveZ & ~w & (0x80 * ones);
+		w -= lower >> 2;
+		memcpy(out + i, &w, 8);
+	}
+	for(; i < n; i++)
+	{
+		char c = in[i];
+		out[i] = (c >= 'a' && c <= 'z') ? c - 0x20 : c;
+	}
+}
+
+/**
+ *  Uppercase of the two-byte UTF-8 character with code point cp, where
+ *   the uppercase also takes two bytes: Latin-1, Latin Extended-A,
+ *   Greek and Cyrillic. Anything else maps to itself.
+ */
+inline unsigned int utf8_upper2(unsigned int cp)
+{
+	if(cp >= 0xE0 && cp <= 0xFE && cp != 0xF7)
+		return cp - 0x20;                             // à..þ
+	if(cp == 0xFF)
+		return 0x178;                                 // ÿ
+	if(cp >= 0x100 && cp <= 0x17F)
+	{
+		// Latin Extended-A alternates upper and lower case in pairs,
+		// except dotted İ and dotless ı: ı uppercases to ASCII I, which
+		// is one byte, so both are left as they are
+		bool oddLower = (cp <= 0x12F) || (cp >= 0x132 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177);
+		bool evenLower = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+		if(oddLower && (cp & 1))
+			return cp - 1;
+		if(evenLower && !(cp & 1))
+			return cp - 1;
+		return cp;
+	}
+	if(cp >= 0x3B1 && cp <= 0x3C9)
+		return cp == 0x3C2 ? 0x3A3 : cp - 0x20;       // α..ω, final ς
+	if(cp >= 0x430 && cp <= 0x44F)
+		return cp - 0x20;                             // а..я
+	if(cp >= 0x450 && cp <= 0x45F)
+		return cp - 0x50;                             // ѐ..џ
+	return cp;
+}
+
+/**
+ *  Uppercase ASCII and the two-byte letters utf8_upper2 knows
+ *   Runs of ASCII go through ascii_toupper; malformed sequences and
+ *   other characters are copied as they are.
+ */
+inline void utf8_toupper(const char * in, size_t n, char * out)
+{
+	size_t i = 0;
+	while(i < n)
+	{
+		size_t run = i;
+		while(run < n && (unsigned char)in[run] < 0x80)
+			run++;
+		ascii_toupper(in + i, run - i, out + i);
+		i = run;
+		if(i == n)
+			break;
+		unsigned char lead = in[i];
+		if(lead >= 0xC2 && lead <= 0xDF && i + 1 < n && ((unsigned char)in[i + 1] & 0xC0) == 0x80)
+		{
+			unsigned int cp = ((lead & 0x1F) << 6) | ((unsigned char)in[i + 1] & 0x3F);
+			unsigned int up = utf8_upper2(cp);
+			out[i] = (char)(0xC0 | (up >> 6));
+			out[i + 1] = (char)(0x80 | (up & 0x3F));
+			i += 2;
+		}
+		else
+		{
+			out[i] = in[i];
+			i++;
+		}
+	}
+}
+
+/**
+ *  Keys stored and matched exactly as given
+ */
+struct ExactKeys
+{
+	static const bool IDENTITY = true;
+	static const uint64_t ID = 0;
+
+	static void normalize(const char * in, size_t n, char * out)
+	{
+		memcpy(out, in, n);
+	}
+};
+
+/**
+ *  ASCII letters match regardless of case; keys are stored uppercase
+ */
+struct AsciiUpperKeys
+{
+	static const bool IDENTITY = false;
+	static const uint64_t ID = 0x4153434949555050ull;
+
+	static void normalize(const char * in, size_t n, char * out)
+	{
+		ascii_toupper(in, n, out);
+	}
+};
+
+/**
+ *  Like AsciiUpperKeys, plus the accented Latin, Greek and Cyrillic
+ *   letters of two-byte UTF-8
+ */
+struct Utf8UpperKeys
+{
+	static const bool IDENTITY = false;
+	static const uint64_t ID = 0x5554463855505050ull;
+
+	static void normalize(const char * in, size_t n, char * out)
+	{
+		utf8_toupper(in, n, out);
+	}
+};
+
+/**
+ *  A key in KEYS' normal form, held on the stack unless it is long
+ *   Views into itself, so it is neither copied nor moved
+ */
+template <typename KEYS>
+class NormalizedKey
+{
+	public:
+		explicit NormalizedKey(string_view key)
+		{
+			if(KEYS::IDENTITY)
+			{
+				text = key;
+				return;
+			}
+			char * out = small;
+			if(key.size() > sizeof(small))
+			{
+				large.resize(key.size());
+				out = &large[0];
+			}
+			KEYS::normalize(key.data(), key.size(), out);
+			text = string_view(out, key.size());
+		}
+
+		NormalizedKey(const NormalizedKey &) = delete;
+		NormalizedKey & operator=(const NormalizedKey &) = delete;
+
+		string_view view() const
+		{
+			return text;
+		}
+
+	private:
+		char small[64];
+		string large;
+		string_view text;
+};
+
+/**
+ *  Non-string keys pass through as they are
+ */
+template <typename LOOKUP>
+class PlainKey
+{
+	public:
+		explicit PlainKey(LOOKUP theKey) : key(theKey) { }
+
+		LOOKUP view() const
+		{
+			return key;
+		}
+
+	private:
+		LOOKUP key;
+};
+
+/**
+ *  Copy of key in KEYS' normal form
+ */
+template <typename KEYS>
+string normalized(string_view key)
+{
+	return string(NormalizedKey<KEYS>(key).view());
+}
+
+#endif
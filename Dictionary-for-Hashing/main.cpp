@@ -14,6 +14,7 @@
 #include "dictionary.h"
 #include "testinghash.h"
 #include "testingdictionary.h"
+#include "benchmarks.h"
 #include <cstdlib>
 #include <time.h>
 
@@ -56,6 +57,7 @@ int main( int argc, char* argv[] )
 	srand( time(NULL));	
 	bool do_test = false;
     bool do_big_test = false;
+    bool do_bench = false;
     for( int i = 0; i < argc; ++i ) {
 	    if( !strcmp(argv[i], "--test" ) ) {
             cout << " [x] Enabling test mode. " << endl;
@@ -66,9 +68,16 @@ int main( int argc, char* argv[] )
             do_test = true;
             do_big_test = true;
         }
+        else if( !strcmp(argv[i], "--bench" ) ) {
+            cout << " [x] Enabling benchmark mode. " << endl;
+            do_bench = true;
+        }
     }
 
-    if( do_test ) {
+    if( do_bench ) {
+        run_benchmarks();               // See benchmarks.h
+    }
+    else if( do_test ) {
         run_test_mode( do_big_test );
 		cout << " [x] Testing program complete. " << endl;
         if( do_big_test )
@@ -0,0 +1,237 @@
+/**
+ *  prefixindex.h - Radix tree over dictionary words for prefix completion
+ *
+ */
+
+#ifndef __PREFIX_INDEX_H
+#define __PREFIX_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+using namespace std;
+/*
+	public:
+		bool insert(string_view word);          // False if already present
+		bool remove(string_view word);          // False if absent
+		void assign(vector<string_view> words); // Replace everything
+		size_t complete(string_view prefix, size_t n, FUNC f);  // f(word) in order
+		size_t size();
+		void clear();
+*/
+
+/*
+ *  A compressed trie: every edge carries a whole run of characters, so a
+ *  node only exists where two words part ways or a word ends. Children
+ *  are kept sorted by their first character.
+ *
+ *  complete() walks the prefix down the edges, one comparison per prefix
+ *  character, and then visits the subtree below it in order, stopping
+ *  after n words; the rest of the tree is never touched. Removing a word
+ *  prunes nodes it leaves childless and merges single-child chains back
+ *  into one edge, so the tree stays as if the word had never been added.
+ */
+class PrefixIndex
+{
+	private:
+		struct Node
+		{
+			string label;                       // Edge from the parent
+			bool terminal = false;              // A word ends here
+			vector<unique_ptr<Node> > children; // Sorted by label[0]
+		};
+
+		Node root;
+		size_t words;
+
+		/**
+		 *  Position in children where a label starting with c is or goes
+		 */
+		static size_t child_at(const Node & node, char c)
+		{
+			auto at = lower_bound(node.children.begin(), node.children.end(), c,
+			                      [](const unique_ptr<Node> & child, char ch) { return child->label[0] < ch; });
+			return at - node.children.begin();
+		}
+
+		static Node * child(const Node & node, char c)
+		{
+			size_t i = child_at(node, c);
+			if(i < node.children.size() && node.children[i]->label[0] == c)
+				return node.children[i].get();
+			return nullptr;
+		}
+
+		static size_t common(string_view a, string_view b)
+		{
+			size_t n = 0, end = min(a.size(), b.size());
+			while(n < end && a[n] == b[n])
+				n++;
+			return n;
+		}
+
+		/**
+		 *  Call f(word) for terminal nodes below node in order, word built in
+		 *   text; stops once left reaches zero
+		 */
+		template <typename FUNC>
+		static void visit(const Node & node, string & text, size_t & left, FUNC & f)
+		{
+			if(node.terminal)
+			{
+				f(string_view(text));
+				if(--left == 0)
+					return;
+			}
+			for(const unique_ptr<Node> & c : node.children)
+			{
+				text += c->label;
+				visit(*c, text, left, f);
+				text.resize(text.size() - c->label.size());
+				if(left == 0)
+					return;
+			}
+		}
+
+	public:
+		PrefixIndex() : words(0) { }
+
+		/**
+		 *  Add word; returns false if it was already there
+		 */
+		bool insert(string_view word)
+		{
+			Node * node = &root;
+			while(!word.empty())
+			{
+				size_t i = child_at(*node, word[0]);
+				if(i == node->children.size() || node->children[i]->label[0] != word[0])
+				{
+					unique_ptr<Node> leaf(new Node);
+					leaf->label = string(word);
+					leaf->terminal = true;
+					node->children.insert(node->children.begin() + i, std::move(leaf));
+					words++;
+					return true;
+				}
+				Node * next = node->children[i].get();
+				size_t m = common(next->label, word);
+				if(m < next->label.size())
+				{
+					// Split the edge where word leaves it
+					unique_ptr<Node> mid(new Node);
+					mid->label = next->label.substr(0, m);
+					next->label.erase(0, m);
+					mid->children.push_back(std::move(node->children[i]));
+					node->children[i] = std::move(mid);
+					next = node->children[i].get();
+				}
+				node = next;
+				word.remove_prefix(m);
+			}
+			if(node->terminal || node == &root)
+				return false;
+			node->terminal = true;
+			words++;
+			return true;
+		}
+
+		/**
+		 *  Drop word; returns false if it was not there
+		 */
+		bool remove(string_view word)
+		{
+			vector<pair<Node *, size_t> > path;    // Parent and child index of each step
+			Node * node = &root;
+			while(!word.empty())
+			{
+				size_t i = child_at(*node, word[0]);
+				if(i == node->children.size())
+					return false;
+				Node * next = node->children[i].get();
+				if(next->label[0] != word[0] || word.substr(0, next->label.size()) != next->label)
+					return false;
+				path.emplace_back(node, i);
+				word.remove_prefix(next->label.size());
+				node = next;
+			}
+			if(!node->terminal)
+				return false;
+			node->terminal = false;
+			words--;
+
+			// Prune a childless leaf, then merge what is left over into one edge
+			if(node->children.empty() && !path.empty())
+			{
+				Node * parent = path.back().first;
+				parent->children.erase(parent->children.begin() + path.back().second);
+				path.pop_back();
+				node = parent;
+			}
+			if(node != &root && !node->terminal && node->children.size() == 1)
+			{
+				unique_ptr<Node> only = std::move(node->children[0]);
+				node->label += only->label;
+				node->terminal = only->terminal;
+				node->children = std::move(only->children);
+			}
+			return true;
+		}
+
+		/**
+		 *  Replace the contents with words, in one sorted pass
+		 */
+		void assign(vector<string_view> list)
+		{
+			clear();
+			sort(list.begin(), list.end());
+			for(string_view w : list)
+				insert(w);
+		}
+
+		/**
+		 *  Call f(word) for up to n words starting with prefix, in order
+		 *   n of 0 means every one; returns how many were found
+		 *   word views a buffer that is only good during the call
+		 */
+		template <typename FUNC>
+		size_t complete(string_view prefix, size_t n, FUNC f) const
+		{
+			const Node * node = &root;
+			string text;
+			while(!prefix.empty())
+			{
+				const Node * next = child(*node, prefix[0]);
+				if(next == nullptr)
+					return 0;
+				size_t m = common(next->label, prefix);
+				if(m < prefix.size() && m < next->label.size())
+					return 0;
+				text += next->label;
+				prefix.remove_prefix(m);
+				node = next;
+			}
+			size_t left = n == 0 ? words : n;
+			if(left == 0)
+				return 0;
+			size_t wanted = left;
+			visit(*node, text, left, f);
+			return wanted - left;
+		}
+
+		size_t size() const
+		{
+			return words;
+		}
+
+		void clear()
+		{
+			root.children.clear();
+			words = 0;
+		}
+};
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ *  Hash table whose readers never lock
+ *   Writers publish immutable entries through atomic pointers and free
+ *   what they replace only after every reader that could see it is gone
+ *
+ */
+
+#ifndef __RCU_HASH_H
+#define __RCU_HASH_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <vector>
+#include "hashtable.h"
+
+using namespace std;
+
+/*
+ *  Epoch based reclamation
+ *   A reader pins itself by publishing the global epoch it started in
+ *   into a free reader slot, and unpins by clearing it. Memory unlinked
+ *   by a writer is tagged with the epoch in which it was retired (the
+ *   global epoch is bumped on every retire) and freed once every pinned
+ *   slot shows a later epoch: those readers all started after the unlink
+ *   and cannot reach it.
+ */
+class EpochManager
+{
+	public:
+		static const int READER_SLOTS = 128;    // Most readers pinned at once
+
+		/**
+		 *  Readers hold one of these while they use shared memory
+		 */
+		class Guard
+		{
+			public:
+				Guard( Guard && other ) : slot(other.slot) { other.slot = nullptr; }
+				Guard( const Guard & ) = delete;
+				Guard & operator=( const Guard & ) = delete;
+				~Guard() {
+					if(slot != nullptr)
+						slot->store(0, memory_order_release);
+				}
+
+			private:
+				friend class EpochManager;
+				explicit Guard( atomic<uint64_t> * theSlot ) : slot(theSlot) { }
+				atomic<uint64_t> * slot;
+		};
+
+		EpochManager() : epoch(1) {
+			for(int i = 0; i < READER_SLOTS; i++)
+				slots[i].epoch.store(0);
+		}
+
+		/**
+		 *  Frees everything still retired; no reader may be pinned
+		 */
+		~EpochManager() {
+			for(Retired & r : retired)
+				r.release(r.ptr);
+		}
+
+		/**
+		 *  Pin the calling thread until the Guard goes away
+		 *   Each thread starts at its own slot so readers rarely share a line
+		 */
+		Guard pin() {
+			static thread_local unsigned int hint = hash<thread::id>()(this_thread::get_id());
+			for(unsigned int i = hint; ; i++) {
+				atomic<uint64_t> & slot = slots[i % READER_SLOTS].epoch;
+				uint64_t idle = 0;
+				if(slot.load(memory_order_relaxed) == 0 &&
+				   slot.compare_exchange_strong(idle, epoch.load())) {
+					// Order the pin before every read of shared memory
+					atomic_thread_fence(memory_order_seq_cst);
+					hint = i % READER_SLOTS;
+					return Guard(&slot);
+				}
+				if(i - hint >= READER_SLOTS)
+					this_thread::yield();
+			}
+		}
+
+		/**
+		 *  Hand over memory already unlinked from every shared pointer
+		 *   release(ptr) runs once no reader can still hold it.
+		 *   Writers must be serialized by the caller.
+		 */
+		void retire(void * ptr, void (*release)(void *)) {
+			retired.push_back(Retired{ epoch.fetch_add(1), ptr, release });
+			if(retired.size() >= RECLAIM_BATCH)
+				reclaim();
+		}
+
+		/**
+		 *  Free whatever no pinned reader can still see
+		 */
+		void reclaim() {
+			atomic_thread_fence(memory_order_seq_cst);
+			uint64_t oldest = epoch.load();
+			for(int i = 0; i < READER_SLOTS; i++) {
+				uint64_t e = slots[i].epoch.load();
+				if(e != 0 && e < oldest)
+					oldest = e;
+			}
+			size_t kept = 0;
+			for(Retired & r : retired) {
+				if(r.epoch < oldest)
+					r.release(r.ptr);
+				else
+					retired[kept++] = r;
+			}
+			retired.resize(kept);
+		}
+
+		int pending() {
+			return retired.size();
+		}
+
+	private:
+		static const size_t RECLAIM_BATCH = 64;
+
+		struct Retired
+		{
+			uint64_t epoch;
+			void * ptr;
+			void (*release)(void *);
+		};
+
+		struct alignas(64) Slot
+		{
+			atomic<uint64_t> epoch;     // 0 when free
+		};
+
+		atomic<uint64_t> epoch;
+		Slot slots[READER_SLOTS];
+		vector<Retired> retired;        // Guarded by the writers' lock
+};
+
+/*
+	public:
+		Guard pin();                              // Keep found entries alive
+		const VALTYPE * find(LOOKUP key, const Guard &);
+		bool find(LOOKUP key, OwnedEntry<VALTYPE> & out);  // Copy out the entry and its text
+		bool visit(LOOKUP key, FUNC f);           // f(const VALTYPE &) while pinned
+		bool contains(LOOKUP key);
+		bool insert(LOOKUP key, VALTYPE val);     // val is moved in
+		bool emplace(ARGS... args);
+		int remove(LOOKUP key);
+		int size();
+		bool empty();
+		float load_factor();
+		void clear();
+		int bucket_count();
+*/
+
+/*
+ *  Readers take no lock at all: they pin an epoch, load the current
+ *  bucket array and walk its chains. Entries are immutable once
+ *  published; only their next pointers change, and only to unlink.
+ *
+ *  Each node carries its entry's text inline (see StringArena hooks), so
+ *  retiring a node frees exactly the text readers might still be using.
+ *
+ *  Writers are serialized by one mutex. Inserting links a new node in
+ *  front of its chain, replacing a value publishes a copy in place of the
+ *  old node, and removing swings the predecessor's next pointer past it.
+ *  Growing builds a complete new bucket array with copied nodes (codes
+ *  are cached, so nothing is rehashed), publishes it with one store and
+ *  retires the old array and nodes as a unit.
+ *
+ *  A pointer from find( key, guard ) stays valid, and its entry
+ *  unchanged, for as long as the guard lives, whatever writers do.
+ */
+template <typename KEYTYPE, typename VALTYPE, typename HASH = SeededHash,
+          typename SIZING = PrimeSizing>
+class RcuHashtable
+{
+	public:
+		typedef typename Hashtable<KEYTYPE, VALTYPE, HASH, SIZING>::LOOKUP LOOKUP;
+		typedef EpochManager::Guard Guard;
+
+	private:
+		static constexpr float MAX_LOAD = 1.0f;    // Grow past one entry per chain
+
+		struct Node
+		{
+			const uint64_t code;
+			const VALTYPE val;
+			atomic<Node *> next;
+
+			Node( uint64_t theCode, VALTYPE && theVal, Node * theNext )
+			  : code(theCode), val(std::move(theVal)), next(theNext) { }
+
+			/**
+			 *  One allocation holding the node with its text right behind it
+			 *   Nodes outlive any table-wide arena, so they own their text
+			 */
+			static Node * make(uint64_t code, VALTYPE && val, Node * next) {
+				void * mem = ::operator new(sizeof(Node) + text_bytes(val));
+				InlineText text{ static_cast<char *>(mem) + sizeof(Node) };
+				intern_into(text, val);
+				return new(mem) Node(code, std::move(val), next);
+			}
+
+			static void destroy(Node * n) {
+				n->~Node();
+				::operator delete(n);
+			}
+		};
+
+		struct Buckets
+		{
+			int count;
+			typename SIZING::Reducer reduce;
+			unique_ptr<atomic<Node *>[]> heads;
+
+			explicit Buckets( int n ) : count(n), reduce(n), heads(new atomic<Node *>[n]) {
+				for(int i = 0; i < n; i++)
+					heads[i].store(nullptr, memory_order_relaxed);
+			}
+
+			/**
+			 *  Delete the array with every node still chained from it
+			 */
+			static void release(void * p) {
+				Buckets * b = static_cast<Buckets *>(p);
+				for(int i = 0; i < b->count; i++) {
+					for(Node * n = b->heads[i].load(memory_order_relaxed); n != nullptr; ) {
+						Node * next = n->next.load(memory_order_relaxed);
+						Node::destroy(n);
+						n = next;
+					}
+				}
+				delete b;
+			}
+		};
+
+		static void release_node(void * p) {
+			Node::destroy(static_cast<Node *>(p));
+		}
+
+		HASH hasher;
+		EpochManager epochs;
+		atomic<Buckets *> buckets;
+		mutex writeLock;                    // Serializes every writer
+		atomic<int> numOfElements;
+
+		/**
+		 *  Node for key in b, or nullptr; caller is pinned or the writer
+		 */
+		static Node * lookup(const Buckets * b, uint64_t code, LOOKUP key) {
+			Node * n = b->heads[b->reduce.bucket((uint32_t)code)].load(memory_order_acquire);
+			for(; n != nullptr; n = n->next.load(memory_order_acquire)) {
+				if(n->code == code && n->val.myword == key)
+					return n;
+			}
+			return nullptr;
+		}
+
+		/**
+		 *  Publish a bucket array twice the size holding copies of every node
+		 *   Caller holds writeLock
+		 */
+		void grow() {
+			Buckets * from = buckets.load(memory_order_relaxed);
+			Buckets * to = new Buckets(SIZING::size_for(from->count + 1));
+			for(int i = 0; i < from->count; i++) {
+				for(Node * n = from->heads[i].load(memory_order_relaxed); n != nullptr;
+				    n = n->next.load(memory_order_relaxed)) {
+					atomic<Node *> & head = to->heads[to->reduce.bucket((uint32_t)n->code)];
+					VALTYPE copy(n->val);
+					head.store(Node::make(n->code, std::move(copy), head.load(memory_order_relaxed)),
+					           memory_order_relaxed);
+				}
+			}
+			buckets.store(to, memory_order_release);
+			epochs.retire(from, &Buckets::release);
+		}
+
+		/**
+		 *  Insert or replace under writeLock
+		 */
+		bool insert_value(LOOKUP key, VALTYPE && val) {
+			uint64_t code = hasher(key);
+			lock_guard<mutex> held(writeLock);
+			Buckets * b = buckets.load(memory_order_relaxed);
+			atomic<Node *> * link = &b->heads[b->reduce.bucket((uint32_t)code)];
+			for(Node * n = link->load(memory_order_relaxed); n != nullptr;
+			    link = &n->next, n = n->next.load(memory_order_relaxed)) {
+				if(n->code == code && n->val.myword == key) {
+					// Readers see either the old node or the whole new one
+					link->store(Node::make(code, std::move(val), n->next.load(memory_order_relaxed)),
+					            memory_order_release);
+					epochs.retire(n, &release_node);
+					return true;
+				}
+			}
+			atomic<Node *> & head = b->heads[b->reduce.bucket((uint32_t)code)];
+			head.store(Node::make(code, std::move(val), head.load(memory_order_relaxed)), memory_order_release);
+			if(++numOfElements > MAX_LOAD * b->count)
+				grow();
+			return true;
+		}
+
+	public:
+		/**
+		 *  Basic constructor
+		 *   startingSize is rounded up to a size the SIZING policy supports
+		 */
+		RcuHashtable( int startingSize = 101, uint64_t seed = fresh_hash_seed() )
+		  : hasher(seed), buckets(new Buckets(SIZING::size_for(startingSize))), numOfElements(0)
+		{
+		}
+
+		RcuHashtable( const RcuHashtable & ) = delete;
+		RcuHashtable & operator=( const RcuHashtable & ) = delete;
+
+		/**
+		 *  No reader may still be pinned
+		 */
+		~RcuHashtable() {
+			Buckets::release(buckets.load());
+		}
+
+		/**
+		 *  Pin the calling thread; pointers from find stay valid until
+		 *   the guard is destroyed
+		 */
+		Guard pin() {
+			return epochs.pin();
+		}
+
+		/**
+		 *  Entry for key, or nullptr, valid for the life of guard
+		 */
+		const VALTYPE * find(LOOKUP key, const Guard &) {
+			Node * n = lookup(buckets.load(memory_order_acquire), hasher(key), key);
+			return n == nullptr ? nullptr : &n->val;
+		}
+
+		/**
+		 *  Call f(entry) for key's entry while pinned
+		 */
+		template <typename FUNC>
+		bool visit(LOOKUP key, FUNC && f) {
+			Guard guard = pin();
+			const VALTYPE * found = find(key, guard);
+			if(found == nullptr)
+				return false;
+			f(*found);
+			return true;
+		}
+
+		/**
+		 *  Copy the entry for key, text and all, into out while pinned
+		 *   Returns false, leaving out alone, if key is absent
+		 */
+		bool find(LOOKUP key, OwnedEntry<VALTYPE> & out) {
+			return visit(key, [&out](const VALTYPE & found) { out.assign(found); });
+		}
+
+		bool contains(LOOKUP key) {
+			Guard guard = pin();
+			return find(key, guard) != nullptr;
+		}
+
+		/**
+		 *  Add an element, replacing any existing entry for key
+		 */
+		bool insert(LOOKUP key, VALTYPE val) {
+			return insert_value(key, std::move(val));
+		}
+
+		/**
+		 *  Build a VALTYPE from args and insert it under its own myword
+		 */
+		template <typename... ARGS>
+		bool emplace(ARGS &&... args) {
+			VALTYPE val(std::forward<ARGS>(args)...);
+			return insert_value(val.myword, std::move(val));
+		}
+
+		/**
+		 *  Remove key; returns number of elements removed
+		 *   Readers already on the node keep walking the chain behind it
+		 */
+		int remove(LOOKUP key) {
+			uint64_t code = hasher(key);
+			lock_guard<mutex> held(writeLock);
+			Buckets * b = buckets.load(memory_order_relaxed);
+			atomic<Node *> * link = &b->heads[b->reduce.bucket((uint32_t)code)];
+			for(Node * n = link->load(memory_order_relaxed); n != nullptr;
+			    link = &n->next, n = n->next.load(memory_order_relaxed)) {
+				if(n->code == code && n->val.myword == key) {
+					link->store(n->next.load(memory_order_relaxed), memory_order_release);
+					epochs.retire(n, &release_node);
+					numOfElements--;
+					return 1;
+				}
+			}
+			return 0;
+		}
+
+		int size() {
+			return numOfElements.load();
+		}
+
+		bool empty() {
+			return size() == 0;
+		}
+
+		int bucket_count() {
+			return buckets.load(memory_order_acquire)->count;
+		}
+
+		float load_factor() {
+			return (float)size() / (float)bucket_count();
+		}
+
+		/**
+		 *  Publish an empty bucket array of the same size
+		 */
+		void clear() {
+			lock_guard<mutex> held(writeLock);
+			Buckets * b = buckets.load(memory_order_relaxed);
+			buckets.store(new Buckets(b->count), memory_order_release);
+			numOfElements = 0;
+			epochs.retire(b, &Buckets::release);
+		}
+};
+
+#endif
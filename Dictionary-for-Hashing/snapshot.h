@@ -0,0 +1,245 @@
+/**
+ *  snapshot.h - Binary snapshots of a hash table's prebuilt layout
+ *
+ */
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dictjson.h"
+
+using namespace std;
+
+/*
+ *  File layout, native byte order, every section 64-byte aligned:
+ *   SnapshotHeader
+ *   dists    signed char[slots + SNAPSHOT_PAD]    -1 for an empty slot
+ *   ctrl     unsigned char[slots + SNAPSHOT_PAD]  7-bit fingerprints
+ *   codes    uint64_t[slots]                      full hash codes
+ *   entries  SnapshotEntry[slots]                 text offsets into pool
+ *   pool     char[poolBytes]                      all text back to back
+ *
+ *  The first four sections are a Hashtable's own arrays written out as
+ *  they stand, so a mapped snapshot answers lookups with the same probe
+ *  and no parsing or rehashing. Opening checks only the header (it has
+ *  its own checksum) and a few bytes of padding; the checksum over the
+ *  rest and the header's entry count mean reading the whole file, so
+ *  they are only checked on request.
+ */
+static const char SNAPSHOT_MAGIC[8] = { 'H', 'T', 'S', 'N', 'A', 'P', '\r', '\n' };
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const size_t SNAPSHOT_PAD = 32;     // Widest probe group any build uses
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerBytes;      // sizeof(SnapshotHeader), catches layout changes
+	uint64_t seed;             // Hash seed the codes were made with
+	uint64_t hashCheck;        // Writer's hash of SNAPSHOT_MAGIC ^ key policy ID, catches
+	                           //  another HASH or KEYS
+	uint64_t bucketCheck;      // Writer's bucket for a fixed code, catches another SIZING
+	uint64_t count;            // Entries
+	uint64_t buckets;
+	uint64_t slots;            // buckets plus overflow slots
+	uint64_t poolBytes;
+	uint64_t distsAt;          // Section offsets from the start of the file
+	uint64_t ctrlAt;
+	uint64_t codesAt;
+	uint64_t entriesAt;
+	uint64_t poolAt;
+	uint64_t fileBytes;
+	uint64_t bodyChecksum;     // Over every byte after the header
+	uint64_t headerChecksum;   // Over every field above
+};
+
+struct SnapshotEntry
+{
+	uint64_t word;             // Offsets into the pool
+	uint64_t definition;
+	uint32_t wordBytes;
+	uint32_t definitionBytes;
+};
+
+/**
+ *  64-bit checksum, eight bytes per multiply
+ */
+inline uint64_t snapshot_checksum( string_view bytes )
+{
+	uint64_t h = 0x9E3779B97F4A7C15ull ^ bytes.size();
+	const char * p = bytes.data();
+	size_t n = bytes.size();
+	for(; n >= 8; p += 8, n -= 8)
+	{
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+		h ^= h >> 32;
+	}
+	uint64_t w = 0;
+	memcpy(&w, p, n);
+	h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+	return h ^ (h >> 29);
+}
+
+/**
+ *  Write a snapshot from a table's arrays
+ *   dists, ctrl and codes hold header.slots entries; the layout fields
+ *   and checksums of header are filled in here
+ */
+inline bool write_snapshot( const string & filename, SnapshotHeader header,
+                            const signed char * dists, const unsigned char * ctrl,
+                            const uint64_t * codes, const vector<SnapshotEntry> & entries,
+                            const string & pool )
+{
+	size_t slots = header.slots;
+	string out(sizeof(SnapshotHeader), '\0');
+	auto section = [&out](const void * data, size_t bytes, char pad, size_t padBytes) {
+		out.resize((out.size() + 63) & ~(size_t)63, '\0');
+		uint64_t at = out.size();
+		out.append(static_cast<const char *>(data), bytes);
+		out.append(padBytes, pad);
+		return at;
+	};
+	header.distsAt = section(dists, slots, (char)-1, SNAPSHOT_PAD);
+	header.ctrlAt = section(ctrl, slots, 0, SNAPSHOT_PAD);
+	header.codesAt = section(codes, slots * sizeof(uint64_t), 0, 0);
+	header.entriesAt = section(entries.data(), slots * sizeof(SnapshotEntry), 0, 0);
+	header.poolAt = section(pool.data(), pool.size(), 0, 0);
+	header.poolBytes = pool.size();
+	header.fileBytes = out.size();
+
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	header.headerBytes = sizeof(SnapshotHeader);
+	header.bodyChecksum = snapshot_checksum(string_view(out).substr(sizeof(SnapshotHeader)));
+	header.headerChecksum = snapshot_checksum(string_view((const char *)&header,
+	                                                      offsetof(SnapshotHeader, headerChecksum)));
+	memcpy(&out[0], &header, sizeof(SnapshotHeader));
+
+	ofstream file(filename.c_str(), ios::binary | ios::trunc);
+	if(!file.is_open())
+		return false;
+	file.write(out.data(), out.size());
+	return (bool)file;
+}
+
+/*
+ *  A snapshot file mapped for random access
+ *   Accessors are only meaningful once check() has passed.
+ */
+class SnapshotFile
+{
+	public:
+		explicit SnapshotFile( const string & filename ) : file(filename, false) { }
+
+		/**
+		 *  Whether filename starts with the snapshot magic
+		 */
+		static bool is_snapshot( const string & filename )
+		{
+			char magic[sizeof(SNAPSHOT_MAGIC)];
+			ifstream in(filename.c_str(), ios::binary);
+			return in.read(magic, sizeof(magic)) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+		}
+
+		/**
+		 *  Empty if the file is a sound snapshot, otherwise what is wrong
+		 *   The body checksum and the entry count are only checked when
+		 *   verifyBody is set, since both read every slot
+		 */
+		string check( bool verifyBody ) const
+		{
+			string_view text = file.text();
+			if(!file.is_open())
+				return "cannot open file";
+			if(text.size() < sizeof(SnapshotHeader) || memcmp(text.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+				return "not a snapshot";
+			const SnapshotHeader & h = header();
+			if(h.version != SNAPSHOT_VERSION || h.headerBytes != sizeof(SnapshotHeader))
+				return "unsupported version " + to_string(h.version);
+			if(h.headerChecksum != snapshot_checksum(text.substr(0, offsetof(SnapshotHeader, headerChecksum))))
+				return "header checksum mismatch";
+			if(h.fileBytes != text.size())
+				return "truncated";
+			if(!fits(h.distsAt, h.slots + SNAPSHOT_PAD) || !fits(h.ctrlAt, h.slots + SNAPSHOT_PAD)
+			   || !fits(h.codesAt, h.slots * sizeof(uint64_t)) || !fits(h.entriesAt, h.slots * sizeof(SnapshotEntry))
+			   || !fits(h.poolAt, h.poolBytes) || (h.codesAt | h.entriesAt) % 8 != 0 || h.count > h.slots)
+				return "bad section layout";
+			for(size_t i = 0; i < SNAPSHOT_PAD; i++)
+			{
+				if(dists()[h.slots + i] != -1)
+					return "bad padding";
+			}
+			if(!verifyBody)
+				return "";
+			if(h.bodyChecksum != snapshot_checksum(text.substr(sizeof(SnapshotHeader))))
+				return "checksum mismatch";
+			uint64_t occupied = 0;
+			for(size_t i = 0; i < h.slots; i++)
+				occupied += dists()[i] >= 0;
+			if(occupied != h.count)
+				return "entry count mismatch";
+			return "";
+		}
+
+		const SnapshotHeader & header() const
+		{
+			return *reinterpret_cast<const SnapshotHeader *>(file.text().data());
+		}
+
+		const signed char * dists() const { return (const signed char *)at(header().distsAt); }
+		const unsigned char * ctrl() const { return (const unsigned char *)at(header().ctrlAt); }
+		const uint64_t * codes() const { return (const uint64_t *)at(header().codesAt); }
+
+		/**
+		 *  Text of slot i's entry; empty if its offsets leave the pool
+		 */
+		string_view word( size_t i ) const
+		{
+			const SnapshotEntry & e = entry(i);
+			return pooled(e.word, e.wordBytes);
+		}
+
+		string_view definition( size_t i ) const
+		{
+			const SnapshotEntry & e = entry(i);
+			return pooled(e.definition, e.definitionBytes);
+		}
+
+	private:
+		MappedFile file;
+
+		const char * at( uint64_t offset ) const
+		{
+			return file.text().data() + offset;
+		}
+
+		bool fits( uint64_t offset, uint64_t bytes ) const
+		{
+			return offset >= sizeof(SnapshotHeader) && offset <= file.text().size()
+			       && bytes <= file.text().size() - offset;
+		}
+
+		const SnapshotEntry & entry( size_t i ) const
+		{
+			return reinterpret_cast<const SnapshotEntry *>(at(header().entriesAt))[i];
+		}
+
+		string_view pooled( uint64_t offset, uint32_t bytes ) const
+		{
+			const SnapshotHeader & h = header();
+			if(offset > h.poolBytes || bytes > h.poolBytes - offset)
+				return string_view();
+			return string_view(at(h.poolAt + offset), bytes);
+		}
+};
+
+#endif
@@ -0,0 +1,262 @@
+/**
+ *  spellindex.h - Symmetric-delete (SymSpell) index for spelling suggestions
+ *
+ */
+
+#ifndef __SPELL_INDEX_H
+#define __SPELL_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include "hashtable.h"
+#include "stringarena.h"
+
+using namespace std;
+/*
+	public:
+		void insert(string_view word);
+		void assign(vector<string_view> words);   // Replace everything
+		size_t suggest(string_view word, size_t n, vector<string> & out, FUNC exists);
+		size_t size();          // Words indexed
+		size_t index_bytes();   // Memory held by the delete index
+		void clear();
+*/
+
+/**
+ *  Edit distance counting insertions, deletions, substitutions and
+ *   swaps of neighbours (optimal string alignment), or max + 1 once
+ *   it is known to be over max
+ */
+inline int edit_distance(string_view a, string_view b, int max)
+{
+	if(a.size() > b.size())
+		swap(a, b);
+	if((int)(b.size() - a.size()) > max)
+		return max + 1;
+	size_t n = a.size();
+	int small[3][64];
+	vector<int> large(n < 64 ? 0 : 3 * (n + 1));
+	int * before = n < 64 ? small[0] : &large[0];
+	int * prev = n < 64 ? small[1] : &large[n + 1];
+	int * row = n < 64 ? small[2] : &large[2 * (n + 1)];
+	for(size_t i = 0; i <= n; i++)
+		prev[i] = i;
+	for(size_t j = 1; j <= b.size(); j++)
+	{
+		row[0] = j;
+		int best = row[0];
+		for(size_t i = 1; i <= n; i++)
+		{
+			int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+			row[i] = min({ prev[i] + 1, row[i - 1] + 1, prev[i - 1] + cost });
+			if(i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+				row[i] = min(row[i], before[i - 2] + 1);
+			best = min(best, row[i]);
+		}
+		if(best > max)
+			return max + 1;
+		swap(before, prev);
+		swap(prev, row);
+	}
+	return min(prev[n], max + 1);
+}
+
+/*
+ *  Every word is indexed under each string its first prefixLength
+ *  characters can become by deleting up to maxDistance of them. A query
+ *  generates the same deletes of its own prefix: any word within
+ *  maxDistance edits shares at least one of them, so only the words
+ *  listed under the query's deletes are ever compared in full.
+ *
+ *  Deletes are stored as 64-bit hashes next to a word number, not as
+ *  strings. Bulk builds (assign) go into one sorted array searched by
+ *  binary search, 16 bytes per delete; words inserted one at a time
+ *  afterwards go into a small hash map, merged into the array once it
+ *  grows past a quarter of it. Lowering prefixLength or maxDistance is
+ *  how memory is bounded: a 7-character prefix at distance 2 gives at
+ *  most 29 deletes per word, however long the word.
+ *
+ *  Words are never removed: suggest() asks the caller whether each
+ *  candidate still exists, and a hash collision only costs one extra
+ *  distance check.
+ */
+class SpellIndex
+{
+	public:
+		/**
+		 *  Index words for suggestions up to maxDistance edits away
+		 *   Only the first prefixLength characters are used for deletes
+		 */
+		explicit SpellIndex( int theMaxDistance = 2, int thePrefixLength = 7 )
+		  : maxDistance(theMaxDistance), prefixLength(max(thePrefixLength, theMaxDistance + 1)),
+		    hasher(0x5EED5EED5EED5EEDull) { }
+
+		/**
+		 *  Add one word, copying its text
+		 */
+		void insert(string_view word)
+		{
+			uint32_t id = words.size();
+			words.push_back(text.copy(word));
+			vector<uint64_t> keys;
+			deletes(word, keys);
+			for(uint64_t key : keys)
+				recent.emplace(key, id);
+			if(recent.size() > MIN_MERGE && recent.size() > sorted.size() / 4)
+				merge();
+		}
+
+		/**
+		 *  Replace the contents with words in one bulk build
+		 */
+		void assign(const vector<string_view> & list)
+		{
+			clear();
+			words.reserve(list.size());
+			vector<uint64_t> keys;
+			for(string_view w : list)
+			{
+				uint32_t id = words.size();
+				words.push_back(text.copy(w));
+				keys.clear();
+				deletes(w, keys);
+				for(uint64_t key : keys)
+					sorted.push_back(Posting{ key, id });
+			}
+			sort(sorted.begin(), sorted.end());
+		}
+
+		/**
+		 *  Up to n words within maxDistance edits of word for which
+		 *   exists(word) holds, closest first and then alphabetical
+		 *   Returns how many were put in out
+		 */
+		template <typename FUNC>
+		size_t suggest(string_view word, size_t n, vector<string> & out, FUNC exists) const
+		{
+			vector<uint64_t> keys;
+			deletes(word, keys);
+			vector<uint32_t> candidates;
+			for(uint64_t key : keys)
+			{
+				auto at = lower_bound(sorted.begin(), sorted.end(), Posting{ key, 0 });
+				for(; at != sorted.end() && at->key == key; ++at)
+					candidates.push_back(at->word);
+				auto range = recent.equal_range(key);
+				for(auto it = range.first; it != range.second; ++it)
+					candidates.push_back(it->second);
+			}
+			sort(candidates.begin(), candidates.end());
+			candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+			vector<pair<int, string_view> > found;
+			for(uint32_t id : candidates)
+			{
+				string_view w = words[id];
+				int d = edit_distance(word, w, maxDistance);
+				if(d <= maxDistance && exists(w))
+					found.emplace_back(d, w);
+			}
+			sort(found.begin(), found.end());
+			found.erase(unique(found.begin(), found.end()), found.end());
+			out.clear();
+			for(size_t i = 0; i < found.size() && out.size() < n; i++)
+				out.emplace_back(found[i].second);
+			return out.size();
+		}
+
+		size_t size() const
+		{
+			return words.size();
+		}
+
+		/**
+		 *  Bytes held by the deletes and word list, text excluded
+		 */
+		size_t index_bytes() const
+		{
+			return sorted.capacity() * sizeof(Posting) + words.capacity() * sizeof(string_view)
+			       + recent.size() * (sizeof(pair<uint64_t, uint32_t>) + 2 * sizeof(void *))
+			       + recent.bucket_count() * sizeof(void *);
+		}
+
+		void clear()
+		{
+			sorted.clear();
+			recent.clear();
+			words.clear();
+			text.clear();
+		}
+
+	private:
+		static const size_t MIN_MERGE = 4096;   // Postings kept in recent before merging
+
+		struct Posting
+		{
+			uint64_t key;      // Hash of one delete
+			uint32_t word;     // Index into words
+
+			bool operator<(const Posting & o) const
+			{
+				return key < o.key || (key == o.key && word < o.word);
+			}
+		};
+
+		int maxDistance;
+		int prefixLength;
+		SeededHash hasher;
+		vector<Posting> sorted;                   // Bulk built, by key
+		unordered_multimap<uint64_t, uint32_t> recent;  // Inserted since
+		vector<string_view> words;
+		StringArena text;
+
+		/**
+		 *  Hashes of every distinct string reachable from word's prefix
+		 *   with up to maxDistance deletions, the prefix itself included
+		 */
+		void deletes(string_view word, vector<uint64_t> & keys) const
+		{
+			string prefix(word.substr(0, prefixLength));
+			vector<string> level(1, prefix), next;
+			keys.push_back(hasher(prefix));
+			for(int d = 0; d < maxDistance; d++)
+			{
+				next.clear();
+				for(const string & s : level)
+				{
+					for(size_t i = 0; i < s.size(); i++)
+					{
+						if(i > 0 && s[i] == s[i - 1])
+							continue;      // Same string as deleting s[i - 1]
+						next.push_back(s.substr(0, i) + s.substr(i + 1));
+					}
+				}
+				sort(next.begin(), next.end());
+				next.erase(unique(next.begin(), next.end()), next.end());
+				for(const string & s : next)
+					keys.push_back(hasher(s));
+				swap(level, next);
+			}
+			sort(keys.begin(), keys.end());
+			keys.erase(unique(keys.begin(), keys.end()), keys.end());
+		}
+
+		/**
+		 *  Fold recent into sorted
+		 */
+		void merge()
+		{
+			size_t middle = sorted.size();
+			for(const pair<const uint64_t, uint32_t> & p : recent)
+				sorted.push_back(Posting{ p.first, p.second });
+			recent.clear();
+			sort(sorted.begin() + middle, sorted.end());
+			inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end());
+		}
+};
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ *  Bump allocator for the text of stored entries
+ *
+ */
+
+#ifndef __STRING_ARENA_H
+#define __STRING_ARENA_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ *  Text is appended to large blocks and handed out as string_views.
+ *  Nothing is freed one string at a time: views stay valid until clear()
+ *  or destruction drops every block at once. Moving an arena keeps its
+ *  views valid, since the blocks themselves never move.
+ */
+class StringArena
+{
+	public:
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+		StringArena() : next(nullptr), left(0), used(0) { }
+
+		StringArena( StringArena && other )
+		  : blocks(std::move(other.blocks)), next(other.next), left(other.left), used(other.used)
+		{
+			other.reset();
+		}
+
+		StringArena & operator=( StringArena && other ) {
+			blocks = std::move(other.blocks);
+			next = other.next;
+			left = other.left;
+			used = other.used;
+			other.reset();
+			return *this;
+		}
+
+		/**
+		 *  Copy s into the arena; the view lives until clear()
+		 */
+		string_view copy(string_view s) {
+			if(s.empty())
+				return string_view();
+			if(s.size() > left)
+				grow(s.size());
+			char * at = next;
+			memcpy(at, s.data(), s.size());
+			next += s.size();
+			left -= s.size();
+			used += s.size();
+			return string_view(at, s.size());
+		}
+
+		/**
+		 *  Take over other's blocks; views into them stay valid
+		 */
+		void adopt(StringArena && other) {
+			for(Block & b : other.blocks)
+				blocks.push_back(std::move(b));
+			used += other.used;
+			other.clear();
+		}
+
+		/**
+		 *  Release every block at once
+		 */
+		void clear() {
+			blocks.clear();
+			reset();
+		}
+
+		size_t bytes_used() const {
+			return used;
+		}
+
+		size_t bytes_reserved() const {
+			size_t total = 0;
+			for(const Block & b : blocks)
+				total += b.size;
+			return total;
+		}
+
+	private:
+		struct Block
+		{
+			unique_ptr<char[]> data;
+			size_t size;
+		};
+
+		vector<Block> blocks;
+		char * next;        // Free space in the newest block
+		size_t left;
+		size_t used;        // Bytes handed out
+
+		void reset() {
+			next = nullptr;
+			left = 0;
+			used = 0;
+		}
+
+		/**
+		 *  Start a block with room for at least n bytes
+		 *   Oversized strings get a block of their own
+		 */
+		void grow(size_t n) {
+			size_t size = max(n, BLOCK_SIZE);
+			blocks.push_back(Block{ unique_ptr<char[]>(new char[size]), size });
+			next = blocks.back().data.get();
+			left = size;
+		}
+};
+
+/**
+ *  Arena over one caller-sized buffer, for entries that carry their
+ *   text inline right behind themselves
+ */
+struct InlineText
+{
+	char * next;
+
+	string_view copy(string_view s) {
+		if(s.empty())
+			return string_view();
+		memcpy(next, s.data(), s.size());
+		next += s.size();
+		return string_view(next - s.size(), s.size());
+	}
+};
+
+/*
+ *  Hooks for value types whose text lives outside the value
+ *   void intern_into(ARENA &, VALTYPE &)  --> copy its text into arena
+ *                                             and point the value at it
+ *   size_t text_bytes(const VALTYPE &)     --> bytes intern_into will copy
+ *  Found by argument-dependent lookup; values that own their text keep
+ *  these defaults.
+ */
+template <typename ARENA, typename VALTYPE>
+void intern_into(ARENA &, VALTYPE &) { }
+
+template <typename VALTYPE>
+size_t text_bytes(const VALTYPE &) { return 0; }
+
+/**
+ *  A value copied out of a table together with its own copy of the text
+ *   Stays valid whatever the table does afterwards. Reach the value
+ *   with * or ->.
+ */
+template <typename VALTYPE>
+class OwnedEntry
+{
+	public:
+		OwnedEntry() { }
+		OwnedEntry( const OwnedEntry & other ) { assign(other.value); }
+
+		OwnedEntry & operator=( const OwnedEntry & other ) {
+			if(this != &other)
+				assign(other.value);
+			return *this;
+		}
+
+		/**
+		 *  Copy v and every byte of text it views
+		 */
+		void assign( const VALTYPE & v ) {
+			text.clear();
+			text.reserve(text_bytes(v));    // Appends below never move it
+			value = v;
+			intern_into(*this, value);
+		}
+
+		/**
+		 *  Arena interface for intern_into
+		 */
+		string_view copy( string_view s ) {
+			size_t at = text.size();
+			text.append(s.data(), s.size());
+			return string_view(text.data() + at, s.size());
+		}
+
+		const VALTYPE & operator*() const { return value; }
+		const VALTYPE * operator->() const { return &value; }
+
+	private:
+		string text;
+		VALTYPE value;
+};
+
+#endif
@@ -55,6 +55,7 @@ void run_dictionary_tests( bool bigtest = false ) {
 	do_test("size",   "UITests/size.txt");
 	do_test("print",  "UITests/print.txt");
 	do_test("random", "UITests/random.txt");
+	do_test("complete", "UITests/complete.txt");
 	do_test("quit",   "UITests/quit.txt");
 
 	if( bigtest )
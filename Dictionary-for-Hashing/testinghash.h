@@ -7,7 +7,42 @@
  */
 
 #include "hashtable.h"
+#include "concurrenthashtable.h"
+#include "rcuhashtable.h"
+#include "prefixindex.h"
+#include "spellindex.h"
 #include "word.h"
+#include <atomic>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+//**************************************************************
+// Global allocation counter for the zero-allocation lookup test
+//  Replaces the program's operator new; only main.cpp includes this file.
+static atomic<unsigned long> test_alloc_count( 0 );
+
+void * operator new( size_t n ) {
+	test_alloc_count++;
+	void * p = malloc( n ? n : 1 );
+	if( p == nullptr )
+		throw bad_alloc();
+	return p;
+}
+
+void * operator new( size_t n, const nothrow_t & ) noexcept {
+	test_alloc_count++;
+	return malloc( n ? n : 1 );
+}
+
+void operator delete( void * p ) noexcept { free( p ); }
+void operator delete( void * p, size_t ) noexcept { free( p ); }
+void operator delete( void * p, const nothrow_t & ) noexcept { free( p ); }
 
 //**************************************************************
 void test_hash_empty() {
@@ -159,6 +194,982 @@ void test_hash_clear() {
 
 }
 
+//**************************************************************
+// Test many inserts/removes through growth, then hits and misses
+//  Exercises Robin Hood displacement, backward-shift deletes and the
+//  control-byte group probing on both sides of every outcome.
+void test_hash_probing() {
+	cout << "  [t] Testing probing with many keys" << endl;;
+	Hashtable<string, Word> ht;
+
+	for( int i = 0; i < 5000; i++ ) {
+		ht.insert( "W" + to_string(i), Word( "W" + to_string(i), "isa word" ) );
+	}
+	for( int i = 0; i < 5000; i += 2 ) {
+		ht.remove( "W" + to_string(i) );
+	}
+	bool ok = ( ht.size() == 2500 );
+	for( int i = 0; i < 5000; i++ ) {
+		ok = ok && ( ht.contains( "W" + to_string(i) ) == ( i % 2 == 1 ) );
+		ok = ok && !ht.contains( "MISS" + to_string(i) );
+	}
+	cout << "   [t] 2500 odd keys present, even keys and misses absent";
+	( ok ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// "az" and "bU" have the same 37*h + ch hash, so every string of seven
+	//  such pairs lands on one bucket whatever the table's size
+	Hashtable<string, Word, PolynomialHash> piled( 11 );
+	for( int i = 0; i < 2000; i++ ) {
+		piled.emplace( "W" + to_string(i), "isa word" );
+	}
+	int stored = 0;
+	bool kept = true;
+	for( int bits = 0; bits < 128; bits++ ) {
+		string key;
+		for( int k = 0; k < 7; k++ )
+			key += ( bits >> k & 1 ) ? "bU" : "az";
+		bool added = piled.emplace( key, "piled up" );
+		stored += added;
+		kept = kept && piled.contains( key ) == added;
+	}
+	for( int i = 0; i < 2000; i++ ) {
+		kept = kept && piled.contains( "W" + to_string(i) );
+	}
+	cout << "   [t] 128 keys on one bucket: " << stored << " stored, " << piled.bucket_count() << " buckets";
+	( kept && stored >= 32 && stored < 128 && piled.size() == 2000 + stored
+	  && piled.load_factor() > 0.05f ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+//**************************************************************
+// Test that lookups never allocate, even for keys too long for SSO
+void test_hash_lookup_allocations() {
+	cout << "  [t] Testing lookups do not allocate" << endl;;
+	Hashtable<string, Word> ht;
+	vector<string> keys;
+	for( int i = 0; i < 1000; i++ ) {
+		keys.push_back( "A RATHER LONG DICTIONARY KEY NUMBER " + to_string(i) );
+		ht.emplace( keys.back(), "isa word" );
+	}
+	string miss = "A RATHER LONG KEY THAT IS NOT IN THE TABLE";
+
+	unsigned long before = test_alloc_count;
+	int found = 0;
+	for( int i = 0; i < 1000; i++ ) {
+		found += ( ht.find( keys[i] ) != nullptr );
+		found += ht.contains( keys[i] );
+		found -= ht.contains( miss );
+	}
+	unsigned long allocs = test_alloc_count - before;
+	cout << "   [t] Allocations over 3000 lookups: " << allocs;
+	( allocs == 0 && found == 2000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	ht.insert( keys[0], Word( keys[0], "redefined" ) );
+	cout << "   [t] Re-inserting a key replaces its definition";
+	( ht.find( keys[0] )->definition == "redefined" && ht.size() == 1000 )
+		? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+//**************************************************************
+// Test reserve(): presized table takes n inserts without growing
+void test_hash_reserve() {
+	cout << "  [t] Testing reserve()" << endl;;
+	Hashtable<string, Word> ht;
+	ht.reserve( 10000 );
+	int buckets = ht.bucket_count();
+	cout << "   [t] Buckets after reserve(10000): " << buckets;
+	( buckets * 0.875 >= 10000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	unsigned int seed = 12345;
+	for( int i = 0; i < 10000; i++ ) {
+		string word;
+		for( int c = 0; c < 8; c++ ) {
+			seed = seed * 1103515245 + 12345;
+			word += (char)( 'A' + ( seed >> 16 ) % 26 );
+		}
+		ht.emplace( word + to_string(i), "isa word" );
+	}
+	cout << "   [t] 10000 inserts did not grow the table";
+	( ht.bucket_count() == buckets && ht.size() == 10000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+//**************************************************************
+// Test bucket sizing policies and that startingSize is honored
+void test_hash_sizing() {
+	cout << "  [t] Testing sizing policies" << endl;;
+	Hashtable<string, Word> primes( 1000 );
+	Hashtable<string, Word, SeededHash, PowerOfTwoSizing> pow2( 1000 );
+	cout << "   [t] Prime table for 1000: " << primes.bucket_count();
+	( primes.bucket_count() == 1543 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+	cout << "   [t] Power-of-two table for 1000: " << pow2.bucket_count();
+	( pow2.bucket_count() == 1024 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	bool ok = true;
+	for( int i = 0; i < 3000; i++ ) {
+		pow2.emplace( to_string(i), "isa word" );
+	}
+	for( int i = 0; i < 3000; i++ ) {
+		ok = ok && pow2.contains( to_string(i) ) && !pow2.contains( "X" + to_string(i) );
+	}
+	cout << "   [t] Power-of-two table grows and finds keys (" << pow2.bucket_count() << ")";
+	( ok && pow2.size() == 3000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+void test_hash_seeding() {
+	cout << "  [t] Testing seeded hashing" << endl;;
+	SeededHash a( 1 ), b( 2 );
+	bool differ = true;
+	bool lengths = true;
+	string key;
+	for( int len = 0; len < 40; len++ ) {
+		differ = differ && a( key ) != b( key );
+		lengths = lengths && a( key ) != a( key + "A" );
+		key += "A";
+	}
+	cout << "   [t] Seeds change codes, every length distinct";
+	( differ && lengths ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word> seeded( 101, 42 );
+	Hashtable<string, Word, PolynomialHash> poly;
+	bool ok = true;
+	for( int i = 0; i < 2000; i++ ) {
+		seeded.emplace( "GRUGRU WORM " + to_string(i), "isa word" );
+		poly.emplace( "GRUGRU WORM " + to_string(i), "isa word" );
+	}
+	for( int i = 0; i < 2000; i++ ) {
+		ok = ok && seeded.contains( "GRUGRU WORM " + to_string(i) ) && poly.contains( "GRUGRU WORM " + to_string(i) );
+	}
+	cout << "   [t] Explicit seed and polynomial hash tables find keys";
+	( ok && !seeded.contains( "GRUGRU" ) && !poly.contains( "GRUGRU" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+// Seeded hash that counts how often keys get hashed
+int test_hash_calls = 0;
+struct CountingHash : SeededHash {
+	explicit CountingHash( uint64_t seed = 0 ) : SeededHash( seed ) { }
+	uint64_t operator()( string_view key ) const { test_hash_calls++; return SeededHash::operator()( key ); }
+	uint64_t operator()( int key ) const { test_hash_calls++; return SeededHash::operator()( key ); }
+};
+
+void test_hash_cached_codes() {
+	cout << "  [t] Testing cached hash codes" << endl;;
+	Hashtable<string, Word, CountingHash> counted( 11 );
+	int startBuckets = counted.bucket_count();
+	test_hash_calls = 0;
+	for( int i = 0; i < 5000; i++ ) {
+		counted.emplace( "GRUGRU WORM " + to_string(i), "isa word" );
+	}
+	cout << "   [t] 5000 inserts through " << startBuckets << " -> " << counted.bucket_count()
+	     << " buckets hash " << test_hash_calls << " times";
+	( test_hash_calls == 5000 && counted.bucket_count() > startBuckets ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	bool ok = true;
+	for( int i = 0; i < 5000; i += 2 ) {
+		ok = ok && counted.remove( "GRUGRU WORM " + to_string(i) ) == 1;
+	}
+	for( int i = 0; i < 5000; i++ ) {
+		ok = ok && counted.contains( "GRUGRU WORM " + to_string(i) ) == ( i % 2 == 1 );
+	}
+	cout << "   [t] Codes follow entries through removes";
+	( ok && counted.size() == 2500 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+void test_hash_concurrent() {
+	cout << "  [t] Testing concurrent sharded table" << endl;;
+	ConcurrentHashtable<string, Word> shared( 8 );
+	const int writers = 4, perWriter = 5000;
+	atomic<bool> readerFailed( false );
+
+	// Writers fill disjoint key ranges while readers keep checking a
+	//  preloaded set that nobody touches
+	for( int i = 0; i < 1000; i++ ) {
+		shared.emplace( "STABLE " + to_string(i), "isa word" );
+	}
+	vector<thread> threads;
+	for( int w = 0; w < writers; w++ ) {
+		threads.emplace_back( [&shared, w]() {
+			for( int i = 0; i < perWriter; i++ ) {
+				shared.emplace( "W" + to_string(w) + " " + to_string(i), "isa word" );
+			}
+			for( int i = 0; i < perWriter; i += 2 ) {
+				shared.remove( "W" + to_string(w) + " " + to_string(i) );
+			}
+		} );
+	}
+	for( int r = 0; r < 2; r++ ) {
+		threads.emplace_back( [&shared, &readerFailed]() {
+			OwnedEntry<Word> found;
+			for( int i = 0; i < 20000; i++ ) {
+				if( !shared.find( "STABLE " + to_string(i % 1000), found ) || found->myword != "STABLE " + to_string(i % 1000) )
+					readerFailed = true;
+			}
+		} );
+	}
+	for( thread & t : threads ) {
+		t.join();
+	}
+
+	cout << "   [t] Readers always saw preloaded keys";
+	( !readerFailed ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	bool ok = true;
+	for( int w = 0; w < writers; w++ ) {
+		for( int i = 0; i < perWriter; i++ ) {
+			ok = ok && shared.contains( "W" + to_string(w) + " " + to_string(i) ) == ( i % 2 == 1 );
+		}
+	}
+	cout << "   [t] Size after concurrent writes: " << shared.size();
+	( ok && shared.size() == 1000 + writers * perWriter / 2 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// A copied-out entry owns its text, so clearing the shard's arena
+	//  leaves it intact
+	OwnedEntry<Word> kept;
+	bool copied = shared.find( "STABLE 7", kept );
+	shared.clear();
+	cout << "   [t] Copied entry outlives clear()";
+	( copied && kept->myword == "STABLE 7" && kept->definition == "isa word" && shared.empty() ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+void test_hash_lockfree_reads() {
+	cout << "  [t] Testing lock-free read table" << endl;;
+	RcuHashtable<string, Word> table( 11 );
+	table.emplace( "MEAGRE", "A large European fish" );
+
+	// A pinned pointer outlives a remove and a replace
+	bool stable;
+	{
+		RcuHashtable<string, Word>::Guard guard = table.pin();
+		const Word * found = table.find( "MEAGRE", guard );
+		table.remove( "MEAGRE" );
+		table.emplace( "MEAGRE", "replaced" );
+		for( int i = 0; i < 500; i++ ) {
+			table.emplace( "FILLER " + to_string(i), "isa word" );   // Grows the table too
+		}
+		stable = found != nullptr && found->definition == "A large European fish";
+	}
+	OwnedEntry<Word> copy;
+	cout << "   [t] Pinned entry survives remove and growth";
+	( stable && table.find( "MEAGRE", copy ) && copy->definition == "replaced" ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// A copied-out entry keeps its text after the node is reclaimed
+	table.remove( "MEAGRE" );
+	for( int i = 0; i < 500; i++ ) {
+		table.emplace( "FILLER " + to_string(i), "isa word" );   // Retires, and so reclaims
+	}
+	OwnedEntry<Word> again( copy );
+	cout << "   [t] Copied entry outlives its node";
+	( copy->myword == "MEAGRE" && again->definition == "replaced" && !table.contains( "MEAGRE" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Readers on a stable key set while a writer grows, replaces and removes
+	for( int i = 0; i < 1000; i++ ) {
+		table.emplace( "STABLE " + to_string(i), "isa word" );
+	}
+	atomic<bool> readerFailed( false ), writing( true );
+	vector<thread> readers;
+	for( int r = 0; r < 3; r++ ) {
+		readers.emplace_back( [&table, &readerFailed, &writing]() {
+			for( int i = 0; writing || i < 2000; i++ ) {
+				string key = "STABLE " + to_string(i % 1000);
+				bool ok = table.visit( key, []( const Word & ) { } );
+				RcuHashtable<string, Word>::Guard guard = table.pin();
+				const Word * found = table.find( key, guard );
+				if( !ok || found == nullptr || found->myword != key || found->definition.size() < 8 )
+					readerFailed = true;
+			}
+		} );
+	}
+	for( int i = 0; i < 20000; i++ ) {
+		table.emplace( "LOAD " + to_string(i), "isa word" );
+		table.emplace( "STABLE " + to_string(i % 1000), "isa word " + to_string(i) );
+		if( i % 3 == 0 )
+			table.remove( "LOAD " + to_string(i) );
+	}
+	writing = false;
+	for( thread & t : readers ) {
+		t.join();
+	}
+	cout << "   [t] Readers saw every key through growth and replacement";
+	( !readerFailed ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	cout << "   [t] Size after writes: " << table.size();
+	( table.size() == 1500 + 20000 - 6667 && !table.contains( "LOAD 3" ) && table.contains( "LOAD 4" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+void test_hash_arena() {
+	cout << "  [t] Testing string arena storage" << endl;;
+	Hashtable<string, Word> ht;
+	for( int i = 0; i < 2000; i++ ) {
+		string word = "GRUGRU WORM " + to_string(i);
+		string def = "The larva of a large South American beetle, number " + to_string(i);
+		ht.insert( word, Word( word, def ) );     // Both strings die right after
+	}
+	bool ok = true;
+	for( int i = 0; i < 2000; i++ ) {
+		Word * found = ht.find( "GRUGRU WORM " + to_string(i) );
+		ok = ok && found != nullptr && found->myword == "GRUGRU WORM " + to_string(i)
+		        && found->definition == "The larva of a large South American beetle, number " + to_string(i);
+	}
+	cout << "   [t] Text outlives the caller's strings";
+	( ok ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	vector<string> words, defs;
+	for( int i = 0; i < 2000; i++ ) {
+		words.push_back( "MEAGRE " + to_string(i) );
+		defs.push_back( "A large European scinoid fish, having white bloodless flesh " + to_string(i) );
+	}
+	Hashtable<string, Word> presized;
+	presized.reserve( 2000 );
+	unsigned long before = test_alloc_count;
+	for( int i = 0; i < 2000; i++ ) {
+		presized.emplace( words[i], defs[i] );
+	}
+	unsigned long allocs = test_alloc_count - before;
+	cout << "   [t] Stored 2000 words with " << allocs << " allocations";
+	( allocs < 10 && presized.size() == 2000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Removing, re-adding and redefining the same words over and over
+	//  leaves dead text behind, which compaction keeps bounded
+	size_t live = presized.arena_bytes(), most = 0;
+	for( int round = 0; round < 40; round++ ) {
+		if( round % 4 == 3 ) {
+			presized.remove_all( words.begin(), words.end() );
+		} else {
+			for( int i = 0; i < 2000; i++ )
+				presized.remove( words[i] );
+		}
+		for( int i = 0; i < 2000; i++ ) {
+			presized.emplace( words[i], "placeholder" );
+			presized.emplace( words[i], defs[i] );
+		}
+		most = max( most, presized.arena_bytes() );
+	}
+	Word * last = presized.find( words[1999] );
+	cout << "   [t] Arena stays under " << most << " bytes over 40 reload rounds";
+	( most < 2 * live + StringArena::BLOCK_SIZE && presized.size() == 2000 && last != nullptr
+	  && last->definition == defs[1999] ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	size_t used = ht.arena_bytes();
+	ht.clear();
+	cout << "   [t] clear() releases " << used << " arena bytes";
+	( used > 2000 * 60 && ht.arena_bytes() == 0 && ht.empty() && !ht.contains( "GRUGRU WORM 1" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+void test_hash_json_load() {
+	cout << "  [t] Testing JSON loader" << endl;;
+	const char * path = "test_hash_tmp.json";
+	{
+		ofstream out( path );
+		out << "{\"dictionary\":[{\"word\":\"MEAGRE\",\"definition\":\"A fish\"},{\"definition\": \"Tab\\there\",\n"
+		    << "\t\t\"word\"\r\n:\"SAY \\\"HI\\\"\"   }  ,\n  {\"word\": \"CAF\\u00C9\", \"extra\": [1, -2.5e3, true, null, {\"x\": {}}],\n"
+		    << "\"definition\": \"Coffee \\ud83d\\ude00\"}]}";
+	}
+	Hashtable<string, Word> ht;
+	ht.load( path );
+	Word * quoted = ht.find( "SAY \"HI\"" );
+	Word * cafe = ht.find( "CAF\xC3\x89" );
+	cout << "   [t] Entries with any layout and escapes: " << ht.size();
+	( ht.size() == 3 && ht.contains( "MEAGRE" ) && quoted != nullptr && quoted->definition == "Tab\there"
+	  && cafe != nullptr && cafe->definition == "Coffee \xF0\x9F\x98\x80" ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	ht.unload( path );
+	cout << "   [t] Unload removes them again";
+	( ht.empty() ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	{
+		ofstream out( path );
+		out << "{\"dictionary\":[{\"word\":\"MEAGRE\",\"definition\":\"A fish\"}, {\"word\": \"BROKEN }";
+	}
+	string_view bad = "{\"a\": [1, 2,, 3]}";
+	int reported = 0;
+	bool rejected = !DictJsonParser( bad ).for_each_entry( [&reported]( string_view, string_view ) { reported++; } );
+	ht.load( path );
+	cout << "   [t] Malformed input is reported, earlier entries kept";
+	( rejected && reported == 0 && ht.size() == 1 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+	std::remove( path );
+
+	// Escapes and quotes straddling every offset of a 64-byte scan block
+	bool straddle = true;
+	for( int pad = 0; pad < 130; pad++ ) {
+		string json = "[" + string( pad, ' ' ) + "{\"word\": \"A\\\\\\\"B\\\\\", \"definition\": \"" + string( pad, 'x' ) + "\\\"{}\"}]";
+		int entries = 0;
+		bool parsed = DictJsonParser( json ).for_each_entry( [&]( string_view word, string_view def ) {
+			entries++;
+			straddle = straddle && word == "A\\\"B\\" && def == string( pad, 'x' ) + "\"{}";
+		} );
+		straddle = straddle && parsed && entries == 1;
+	}
+	cout << "   [t] Escapes across scan block boundaries";
+	( straddle ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  Batch removal: one sweep for big batches, counts, duplicates
+ */
+void test_hash_remove_all() {
+	cout << "  [t] Testing remove_all()" << endl;;
+	Hashtable<string, Word> ht( 11 );
+	for( int i = 0; i < 6000; i++ )
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+
+	// Every third key, some twice, plus keys that were never there
+	vector<string> doomed;
+	for( int i = 0; i < 6000; i += 3 )
+		doomed.push_back( "GRUGRU WORM " + to_string( i ) );
+	doomed.push_back( "GRUGRU WORM 3" );
+	doomed.push_back( "NOT A WORD" );
+	int removed = ht.remove_all( doomed.begin(), doomed.end() );
+	bool ok = removed == 2000 && ht.size() == 4000;
+	for( int i = 0; i < 6000 && ok; i++ )
+		ok = ht.contains( "GRUGRU WORM " + to_string( i ) ) == ( i % 3 != 0 );
+	cout << "   [t] Big batch removes " << removed << " of 2002 keys";
+	( ok ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	vector<string> few = { "GRUGRU WORM 1", "GRUGRU WORM 1", "GRUGRU WORM 0" };
+	removed = ht.remove_all( few.begin(), few.end() );
+	for( int i = 0; i < 6000; i++ )
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+	cout << "   [t] Small batch, then the table refills";
+	( removed == 1 && ht.size() == 6000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	const char * path = "test_hash_tmp.json";
+	{
+		ofstream out( path );
+		out << "{\"dictionary\": [";
+		for( int i = 0; i < 6000; i += 2 )
+			out << "{\"word\": \"GRUGRU WORM " << i << "\", \"definition\": \"\"},";
+		out << "{\"word\": \"GRUGRU\\u0020WORM 1\", \"definition\": \"\"}]}";
+	}
+	int unloaded = ht.unload( path );
+	std::remove( path );
+	cout << "   [t] unload() reports " << unloaded << " removed";
+	( unloaded == 3001 && ht.size() == 2999 && !ht.contains( "GRUGRU WORM 1" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  random_entry() stays uniform through growth, removes and batches
+ */
+void test_hash_random() {
+	cout << "  [t] Testing random_entry()" << endl;;
+	Hashtable<string, Word> ht( 11, 5 );
+	for( int i = 0; i < 3000; i++ )
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+	for( int i = 0; i < 3000; i += 4 )
+		ht.remove( "GRUGRU WORM " + to_string( i ) );
+	vector<string> batch;
+	for( int i = 1; i < 3000; i += 4 )
+		batch.push_back( "GRUGRU WORM " + to_string( i ) );
+	ht.remove_all( batch.begin(), batch.end() );
+	for( int i = 3000; i < 3500; i++ )     // Grows again, mid-migration
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+
+	map<string, int> seen;
+	const int draws = 400000;
+	bool valid = true;
+	for( int i = 0; i < draws && valid; i++ ) {
+		Word * w = ht.random_entry();
+		valid = w != nullptr && ht.contains( w->myword );
+		if( valid )
+			seen[string( w->myword )]++;
+	}
+	int fewest = draws, most = 0;
+	for( auto & kv : seen ) {
+		fewest = min( fewest, kv.second );
+		most = max( most, kv.second );
+	}
+	// 2000 words, 200 draws each on average; 5 standard deviations is about 70
+	cout << "   [t] " << seen.size() << " of " << ht.size() << " words drawn " << fewest << " to " << most << " times";
+	( valid && (int)seen.size() == ht.size() && fewest > 130 && most < 270 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word> none;
+	cout << "   [t] Empty table gives nullptr";
+	( none.random_entry() == nullptr ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  Parallel structural scan and chunked loads match a sequential load
+ */
+void test_hash_parallel_load() {
+	cout << "  [t] Testing parallel JSON loading" << endl;;
+
+	// Raw newlines inside strings make chunks guess their start state wrong
+	string json = "{\"dictionary\": [\n";
+	for( int i = 0; i < 300; i++ )
+		json += "{\"word\": \"W" + to_string( i ) + ( i % 7 == 0 ? "\n\\\"\n" : "" )
+		        + "\", \"definition\": \"line\nbreak\"},\n";
+	json += "{\"word\": \"END\", \"definition\": \"\"}\n], \"after\": [{\"word\": \"TAIL\", \"definition\": \"x\"}]}\n";
+	vector<string> sequential;
+	DictJsonParser( json ).for_each_entry( [&]( string_view w, string_view ) { sequential.emplace_back( w ); } );
+	bool same = sequential.size() == 302;
+	for( int threads = 2; threads <= 9; threads++ ) {
+		vector<vector<string> > parts( threads + 2 );
+		int used;
+		size_t errorAt;
+		bool ok = for_each_dict_part( json, threads, [&]( int part, string_view w, string_view ) {
+			parts[part].emplace_back( w );
+		}, used, errorAt, 1 );
+		vector<string> joined;
+		for( int i = 0; i < used; i++ )
+			joined.insert( joined.end(), parts[i].begin(), parts[i].end() );
+		same = same && ok && joined == sequential && used > 2 && parts[1].size() > 0;
+	}
+	cout << "   [t] Parts parsed on threads join up to one parse";
+	( same ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Errors inside a part, and between parts, are where one parser finds them
+	vector<string> broken = { json, json, json, json };
+	broken[0].insert( broken[0].find( "{\"word\"", broken[0].size() / 2 ) + 1, "]" );
+	broken[1][ broken[1].find( "},", broken[1].size() / 3 ) + 1 ] = ' ';
+	broken[2].insert( broken[2].find( ",\n{", broken[2].size() * 2 / 3 ) + 1, "7" );
+	broken[3].erase( broken[3].find( "]" ), 1 );
+	bool errorsMatch = true;
+	for( const string & bad : broken ) {
+		DictJsonParser one( bad );
+		vector<string> want;
+		bool wantOk = one.for_each_entry( [&]( string_view w, string_view ) { want.emplace_back( w ); } );
+		for( int threads = 2; threads <= 6; threads++ ) {
+			vector<vector<string> > parts( threads + 2 );
+			int used;
+			size_t errorAt;
+			bool ok = for_each_dict_part( bad, threads, [&]( int part, string_view w, string_view ) {
+				parts[part].emplace_back( w );
+			}, used, errorAt, 1 );
+			vector<string> got;
+			for( int i = 0; i < used; i++ )
+				got.insert( got.end(), parts[i].begin(), parts[i].end() );
+			errorsMatch = errorsMatch && !wantOk && !ok && errorAt == one.error_offset() && got == want;
+		}
+	}
+	cout << "   [t] Malformed input stops at the same byte with the same entries";
+	( errorsMatch ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Big enough for several chunks; later duplicates must win every time
+	const char * path = "test_hash_tmp.json";
+	{
+		ofstream out( path );
+		out << "{\"dictionary\": [\n";
+		for( int i = 0; i < 30000; i++ )
+			out << "  {\"word\": \"KEY " << i % 20000 << "\", \"definition\": \"Pass " << i / 20000
+			    << " of a fairly long definition \\\"quoted\\\" to pad the file out.\"},\n";
+		out << "  {\"word\": \"LAST\", \"definition\": \"done\"}\n]}\n";
+	}
+	Hashtable<string, Word> one( 101, 42 ), two( 101, 42 ), four( 101, 42 );
+	ConcurrentHashtable<string, Word> sharded( 16, 101, 42 );
+	one.load( path, 1 );
+	two.load( path, 2 );
+	four.load( path, 4 );
+	sharded.load( path, 4 );
+	std::remove( path );
+	ostringstream printedOne, printedTwo, printedFour;
+	one.print( 0, printedOne );
+	two.print( 0, printedTwo );
+	four.print( 0, printedFour );
+	bool sameLayout = one.bucket_count() == four.bucket_count() && printedOne.str() == printedTwo.str()
+	                  && printedOne.str() == printedFour.str();
+	bool match = one.size() == 20001 && four.size() == one.size() && sharded.size() == one.size();
+	for( int i = 0; i < 20000 && match; i++ ) {
+		string key = "KEY " + to_string( i );
+		string expect = string( "Pass " ) + ( i < 10000 ? "1" : "0" ) + " of a fairly long definition \"quoted\" to pad the file out.";
+		Word * a = one.find( key ), * b = four.find( key );
+		OwnedEntry<Word> c;
+		match = a != nullptr && b != nullptr && sharded.find( key, c )
+		        && a->definition == expect && b->definition == expect && c->definition == expect;
+	}
+	cout << "   [t] 1 thread, 4 threads and sharded load agree: " << four.size();
+	( match ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	cout << "   [t] 1, 2 and 4 thread loads print in the same order";
+	( sameLayout ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  Binary snapshots: save, map back in without hashing, copy on change
+ */
+void test_hash_snapshot() {
+	cout << "  [t] Testing binary snapshots" << endl;;
+	const char * path = "test_hash_tmp.snap";
+	Hashtable<string, Word, CountingHash> saved( 11, 7 );
+	for( int i = 0; i < 3000; i++ )
+		saved.emplace( "GRUGRU WORM " + to_string( i ), "Definition " + to_string( i ) );
+	saved.remove( "GRUGRU WORM 17" );
+	bool written = saved.save( path );
+
+	Hashtable<string, Word, CountingHash> mapped( 11, 99 );
+	test_hash_calls = 0;
+	mapped.load( path );
+	long loadHashes = test_hash_calls;
+	bool same = written && mapped.size() == saved.size() && mapped.bucket_count() == saved.bucket_count()
+	            && !mapped.contains( "GRUGRU WORM 17" );
+	for( int i = 0; i < 3000 && same; i++ ) {
+		Word w;
+		bool found = mapped.find( "GRUGRU WORM " + to_string( i ), w );
+		same = i == 17 ? !found : found && w.definition == "Definition " + to_string( i );
+	}
+	Word first, second, drawn;
+	same = same && mapped.find( "GRUGRU WORM 1", first ) && mapped.find( "GRUGRU WORM 2", second )
+	       && first.definition == "Definition 1" && mapped.random_entry( drawn ) && !drawn.myword.empty();
+	cout << "   [t] Snapshot maps back in with " << loadHashes << " key hashes";
+	( same && loadHashes <= 1 && mapped.arena_bytes() == 0 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// A pointer into a mapped table is a real entry: no aliasing, writes stick
+	Hashtable<string, Word, CountingHash> pointed( 11, 99 );
+	pointed.load( path );
+	Word * one = pointed.find( "GRUGRU WORM 1" ), * two = pointed.find( "GRUGRU WORM 2" );
+	bool real = one != nullptr && two != nullptr && one != two && one->definition == "Definition 1";
+	if( real )
+		one->definition = "Rewritten";
+	Word again;
+	cout << "   [t] Pointers into a mapped table stay its own";
+	( real && pointed.find( "GRUGRU WORM 1", again ) && again.definition == "Rewritten"
+	  && two->definition == "Definition 2" && pointed.random_entry() != nullptr ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	mapped.emplace( "DEWLAPPED", "Furnished with a dewlap." );
+	Word * kept = mapped.find( "GRUGRU WORM 2999" );
+	cout << "   [t] First change copies it out";
+	( mapped.size() == 3000 && mapped.contains( "DEWLAPPED" ) && kept != nullptr
+	  && kept->definition == "Definition 2999" && mapped.arena_bytes() > 0 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// A header count that disagrees with the slots, behind a good header
+	// checksum: a verified load refuses it, and an unverified one still
+	// draws in bounded time and counts right once copied out
+	auto miscount = [path]( uint64_t count ) {
+		fstream file( path, ios::in | ios::out | ios::binary );
+		SnapshotHeader h;
+		file.read( (char *)&h, sizeof( h ) );
+		h.count = count;
+		h.headerChecksum = snapshot_checksum( string_view( (const char *)&h, offsetof( SnapshotHeader, headerChecksum ) ) );
+		file.seekp( 0 );
+		file.write( (const char *)&h, sizeof( h ) );
+	};
+	miscount( 3001 );
+	Hashtable<string, Word, CountingHash> refused, trusted;
+	refused.load_snapshot( path, true );
+	trusted.load_snapshot( path );
+	Word drawn2;
+	bool miscountOk = refused.empty() && trusted.size() == 3001 && trusted.random_entry( drawn2 );
+	Hashtable<string, Word, CountingHash> vacant( 11 );
+	vacant.emplace( "MEAGRE", "A fish" );
+	vacant.remove( "MEAGRE" );
+	vacant.save( path );
+	miscount( 5 );
+	Hashtable<string, Word, CountingHash> hollow;
+	hollow.load_snapshot( path );
+	Word none;
+	cout << "   [t] Wrong entry count: refused when verified, bounded otherwise";
+	( miscountOk && hollow.size() == 5 && !hollow.random_entry( none ) && hollow.empty()
+	  && hollow.random_entry() == nullptr ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+	saved.save( path );
+
+	// Into a table that already has entries, the snapshot is merged
+	Hashtable<string, Word, CountingHash> merged;
+	merged.emplace( "MEAGRE", "A fish" );
+	merged.load( path );
+	bool mergedOk = merged.size() == 3000 && merged.contains( "MEAGRE" ) && merged.contains( "GRUGRU WORM 5" );
+
+	// One flipped byte in the text pool is caught by the full check only
+	{
+		fstream file( path, ios::in | ios::out | ios::binary );
+		file.seekp( -3, ios::end );
+		file.put( '#' );
+	}
+	Hashtable<string, Word, CountingHash> unchecked, checked;
+	unchecked.load_snapshot( path );
+	checked.load_snapshot( path, true );
+	Hashtable<string, Word, PolynomialHash> otherHash;
+	otherHash.load( path );
+	std::remove( path );
+	cout << "   [t] Merging, checksums and hash mismatches";
+	( mergedOk && unchecked.size() == 2999 && checked.empty() && otherHash.empty() ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  Prefix index against a sorted set through random adds and removes
+ */
+void test_hash_prefix_index() {
+	cout << "  [t] Testing prefix index" << endl;;
+	PrefixIndex index;
+	set<string> expect;
+	unsigned int x = 2017;
+	bool same = true;
+	for( int step = 0; step < 20000 && same; step++ ) {
+		// Short words over a small alphabet share lots of prefixes
+		x = x * 1103515245u + 12345u;
+		string word( 1 + ( x >> 16 ) % 6, 'A' );
+		for( size_t i = 0; i < word.size(); i++ ) {
+			x = x * 1103515245u + 12345u;
+			word[i] = 'A' + ( x >> 16 ) % 3;
+		}
+		bool added = ( step % 3 != 2 ) ? index.insert( word ) : false;
+		bool removed = ( step % 3 == 2 ) ? index.remove( word ) : false;
+		same = ( step % 3 != 2 ) ? added == expect.insert( word ).second
+		                         : removed == ( expect.erase( word ) == 1 );
+
+		string prefix = word.substr( 0, 1 + step % 3 );
+		vector<string> got, want;
+		index.complete( prefix, 5, [&got]( string_view w ) { got.emplace_back( w ); } );
+		for( auto it = expect.lower_bound( prefix ); it != expect.end() && want.size() < 5
+		     && it->compare( 0, prefix.size(), prefix ) == 0; ++it )
+			want.push_back( *it );
+		same = same && got == want && index.size() == expect.size();
+	}
+	cout << "   [t] Completions match a sorted set: " << index.size() << " words";
+	( same ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word> ht;
+	ht.emplace( "MYRISTIC", "Pertaining to the nutmeg" );
+	ht.emplace( "MYRISTIN", "A fat found in nutmeg" );
+	ht.emplace( "MEAGRE", "A fish" );
+	vector<string_view> words;
+	ht.for_each( [&words]( const Word & w ) { words.push_back( w.myword ); } );
+	index.assign( words );
+	string all;
+	size_t found = index.complete( "MYR", 0, [&all]( string_view w ) { all += string( w ) + " "; } );
+	cout << "   [t] Built from a table: " << all;
+	( found == 2 && all == "MYRISTIC MYRISTIN " && index.complete( "MYRX", 0, []( string_view ) { } ) == 0 )
+		? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+/**
+ *  Spelling suggestions against a scan of every word
+ */
+void test_hash_spelling() {
+	cout << "  [t] Testing spelling suggestions" << endl;;
+	cout << "   [t] Edit distances";
+	( edit_distance( "MEAGRE", "MEAGRE", 2 ) == 0 && edit_distance( "MEAGRE", "MAEGRE", 2 ) == 1
+	  && edit_distance( "MEAGRE", "MEGRE", 2 ) == 1 && edit_distance( "KITTEN", "SITTING", 5 ) == 3
+	  && edit_distance( "KITTEN", "SITTING", 2 ) == 3 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Half the words bulk built, half added one by one; every tenth removed
+	unsigned int x = 223;
+	vector<string> words;
+	for( int i = 0; i < 12000; i++ ) {
+		x = x * 1103515245u + 12345u;
+		string w( 3 + ( x >> 16 ) % 8, 'A' );
+		for( char & c : w ) {
+			x = x * 1103515245u + 12345u;
+			c = 'A' + ( x >> 16 ) % 5;
+		}
+		words.push_back( w );
+	}
+	SpellIndex full( 2, 20 );
+	full.assign( vector<string_view>( words.begin(), words.begin() + 6000 ) );
+	for( int i = 6000; i < 12000; i++ )
+		full.insert( words[i] );
+	set<string> live( words.begin(), words.end() );
+	for( int i = 0; i < 12000; i += 10 )
+		live.erase( words[i] );
+	auto exists = [&live]( string_view w ) { return live.count( string( w ) ) > 0; };
+
+	bool same = true;
+	for( int q = 0; q < 300 && same; q++ ) {
+		x = x * 1103515245u + 12345u;
+		string query = words[( x >> 16 ) % words.size()];
+		x = x * 1103515245u + 12345u;
+		query[( x >> 16 ) % query.size()] = 'A' + ( x >> 8 ) % 6;
+		if( q % 2 )
+			query.erase( query.size() / 2, 1 );
+		vector<pair<int, string> > scan;
+		for( const string & w : live ) {
+			int d = edit_distance( query, w, 2 );
+			if( d <= 2 )
+				scan.emplace_back( d, w );
+		}
+		sort( scan.begin(), scan.end() );
+		vector<string> want, got;
+		for( size_t i = 0; i < scan.size() && want.size() < 8; i++ )
+			want.push_back( scan[i].second );
+		full.suggest( query, 8, got, exists );
+		same = got == want;
+	}
+	cout << "   [t] Suggestions match a full scan";
+	( same ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	SpellIndex capped;
+	capped.insert( "ELEUTHEROMANIA" );
+	capped.insert( "ELEUTHEROMANIAC" );
+	vector<string> got;
+	capped.suggest( "ELUETHEROMANIA", 5, got, []( string_view ) { return true; } );
+	cout << "   [t] Long words through a 7-character prefix";
+	( got.size() == 2 && got[0] == "ELEUTHEROMANIA" ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+//**************************************************************
+// Key policies: SIMD uppercasing matches a scalar loop, and tables
+//  with a policy match keys regardless of case without allocating
+void test_hash_key_policy() {
+	cout << "  [t] Testing key normalization policies" << endl;;
+	srand( 49 );
+	bool same = true;
+	for( int trial = 0; trial < 2000 && same; trial++ ) {
+		size_t n = rand() % 101, offset = rand() % 8;
+		string in( n + offset, ' ' );
+		for( char & c : in )
+			c = (char)( rand() % 256 );
+		string want( n, ' ' ), got( n, ' ' );
+		for( size_t i = 0; i < n; i++ ) {
+			char c = in[offset + i];
+			want[i] = ( c >= 'a' && c <= 'z' ) ? c - 32 : c;
+		}
+		ascii_toupper( in.data() + offset, n, &got[0] );
+		same = got == want;
+	}
+	cout << "   [t] ascii_toupper matches a byte loop";
+	( same ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	string mixed = "caf\xc3\xa9 \xc3\xbf \xce\xb1\xcf\x82 \xd0\xb4\xd1\x91 \xc4\x81 \xe2\x82\xac \xc3";
+	string upper = "CAF\xc3\x89 \xc5\xb8 \xce\x91\xce\xa3 \xd0\x94\xd0\x81 \xc4\x80 \xe2\x82\xac \xc3";
+	cout << "   [t] utf8_toupper folds two-byte letters";
+	( normalized<Utf8UpperKeys>( mixed ) == upper ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word, SeededHash, PrimeSizing, AsciiUpperKeys> ht;
+	vector<string> keys;
+	for( int i = 0; i < 1000; i++ ) {
+		keys.push_back( "Grugru Worm " + to_string( i ) );
+		ht.emplace( keys.back(), "isa word" );
+	}
+	string longKey( 100, 'q' );
+	ht.insert( longKey, Word( longKey, "long" ) );
+	ht.insert( "GRUGRU WORM 7", Word( "GRUGRU WORM 7", "replaced" ) );
+	Word * seven = ht.find( "grugru worm 7" );
+	cout << "   [t] Keys stored uppercase and matched in any case";
+	( ht.size() == 1001 && seven != nullptr && seven->myword == "GRUGRU WORM 7"
+	  && seven->definition == "replaced" && ht.contains( "GRUGRU worm 999" )
+	  && ht.contains( string( 100, 'Q' ) ) && !ht.contains( "grugru worm 1000" ) )
+		? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	unsigned long before = test_alloc_count;
+	int found = 0;
+	for( int i = 0; i < 1000; i++ )
+		found += ht.contains( keys[i] );
+	unsigned long allocs = test_alloc_count - before;
+	cout << "   [t] Allocations over 1000 mixed-case lookups: " << allocs;
+	( allocs == 0 && found == 1000 ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	vector<string> batch = { "grugru worm 1", "Grugru Worm 2", longKey };
+	int removed = ht.remove( "gRUGRU wORM 0" );
+	removed += ht.remove_all( batch.begin(), batch.end() );
+	cout << "   [t] remove and remove_all match in any case";
+	( removed == 4 && ht.size() == 997 && !ht.contains( "GRUGRU WORM 2" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word, SeededHash, PrimeSizing, Utf8UpperKeys> utf8;
+	utf8.emplace( "caf\xc3\xa9", "coffee" );
+	Hashtable<string, Word> exact;
+	exact.emplace( "Cafe", "coffee" );
+	cout << "   [t] Utf8UpperKeys folds accents, ExactKeys keeps case";
+	( utf8.contains( "CAF\xc3\x89" ) && utf8.contains( "Caf\xc3\xa9" ) && exact.contains( "Cafe" )
+	  && !exact.contains( "CAFE" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	// Dotless ı and dotted İ are not a case pair; both stay themselves
+	utf8.emplace( "\xc4\xb1ssue", "dotless" );
+	cout << "   [t] Utf8UpperKeys leaves dotless and dotted i apart";
+	( normalized<Utf8UpperKeys>( "\xc4\xb1\xc4\xb0\xc4\xb3" ) == "\xc4\xb1\xc4\xb0\xc4\xb2"
+	  && utf8.contains( "\xc4\xb1SSUE" ) && !utf8.contains( "\xc4\xb0SSUE" ) && !utf8.contains( "ISSUE" )
+	  && !utf8.contains( "issue" ) ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
+//**************************************************************
+// Iterators see every entry once, mid-migration and over a mapped
+//  snapshot; print writes whole lines and stops at num
+void test_hash_iteration() {
+	cout << "  [t] Testing iterators and print" << endl;;
+	Hashtable<string, Word> ht( 11, 3 );
+	for( int i = 0; i < 3000; i++ )
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+	for( int i = 0; i < 3000; i += 5 )
+		ht.remove( "GRUGRU WORM " + to_string( i ) );
+	for( int i = 3000; i < 3300; i++ )     // Grows again, mid-migration
+		ht.emplace( "GRUGRU WORM " + to_string( i ), "isa word" );
+
+	set<string> seen;
+	int visits = 0;
+	for( const Word & w : ht ) {
+		seen.insert( string( w.myword ) );
+		visits++;
+	}
+	bool all = visits == ht.size() && (int)seen.size() == ht.size();
+	for( const string & w : seen )
+		all = all && ht.contains( w );
+	cout << "   [t] " << visits << " entries visited for " << ht.size();
+	( all ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	Hashtable<string, Word> none;
+	const char * path = "test_hash_tmp.snap";
+	ht.save( path );
+	Hashtable<string, Word> mapped;
+	mapped.load( path );
+	remove( path );
+	set<string> mappedSeen;
+	for( Hashtable<string, Word>::iterator it = mapped.begin(); it != mapped.end(); it++ )
+		mappedSeen.insert( string( it->myword ) );
+	cout << "   [t] Mapped snapshot and empty table iterate";
+	( mappedSeen == seen && none.begin() == none.end() ) ? cout << " - pass" : cout << " - fail";
+	cout << endl;
+
+	ostringstream some, every;
+	ht.print( 7, some );
+	ht.print( 0, every );
+	string first = some.str(), whole = every.str();
+	size_t lines = count( first.begin(), first.end(), '\n' );
+	size_t allLines = count( whole.begin(), whole.end(), '\n' );
+	cout << "   [t] print 7 gives " << lines << " lines, print 0 gives " << allLines;
+	( lines == 7 && (int)allLines == ht.size() && whole.compare( 0, first.size(), first ) == 0 )
+		? cout << " - pass" : cout << " - fail";
+	cout << endl;
+}
+
 
 //**************************************************************
 void run_hashtable_tests() {
@@ -172,9 +1183,27 @@ void run_hashtable_tests() {
 	test_hash_size();			// Test size
 	test_hash_contains();	// Test contains
 	test_hash_remove();		// Test remove
+	test_hash_remove_all();	// Batch remove and unload
+	test_hash_random();		// Uniform random_entry()
 	test_hash_find();			// Test find
 	test_hash_loadfactor();	// Test load factor - also rehash()
 	test_hash_clear();		// test clear
+	test_hash_probing();	// Many keys: displacement, shifts, misses
+	test_hash_lookup_allocations();	// find/contains are allocation free
+	test_hash_reserve();	// Presizing with reserve()
+	test_hash_sizing();		// Prime and power-of-two bucket policies
+	test_hash_seeding();	// Seeded default and pluggable HASH
+	test_hash_cached_codes();	// Growing never rehashes keys
+	test_hash_concurrent();		// Sharded table under threads
+	test_hash_lockfree_reads();	// Epoch-protected readers
+	test_hash_arena();		// Word text lives in the table's arena
+	test_hash_json_load();	// Mapped single-pass JSON loader
+	test_hash_parallel_load();	// Chunked scan on many threads
+	test_hash_snapshot();	// Save and map back binary snapshots
+	test_hash_prefix_index();	// Radix tree completion over words
+	test_hash_spelling();	// Symmetric-delete suggestions
+	test_hash_key_policy();	// Case-insensitive keys without copies
+	test_hash_iteration();	// begin()/end() and buffered print
 	cout << " [t] hash class tests complete." << endl;
 
 }
@@ -10,27 +10,49 @@
 #define __WORD_H
 
 #include <string>
+#include <string_view>
+#include <utility>
+#include "stringarena.h"
 
 using namespace std;
 
+/*
+ *  A Word only views its text. Tables copy the text into their own
+ *  StringArena when the Word is stored, so a Word built from temporaries
+ *  is fine to pass to insert()/emplace(), and a Word found in a table
+ *  stays valid until that table is cleared or destroyed.
+ */
 class Word
 {
 	public:
 
-	string myword;
-	string definition;
+	string_view myword;
+	string_view definition;
 
-	Word( ) : myword( "" ), definition( "" ) { }
-	Word( string w, string def ) : myword( w ), definition( def ) { }
+	Word( ) { }
+	Word( string_view w, string_view def ) : myword( w ), definition( def ) { }
 
-	string to_string()
+	string to_string() const
 	{
-		string ret = myword + " : " + definition;
+		string ret = string(myword) + " : " + string(definition);
 		return ret;
 	}
 
 };
-bool operator == (Word str1, const Word str2)
+
+template <typename ARENA>
+void intern_into( ARENA & arena, Word & w )
+{
+	w.myword = arena.copy( w.myword );
+	w.definition = arena.copy( w.definition );
+}
+
+inline size_t text_bytes( const Word & w )
+{
+	return w.myword.size() + w.definition.size();
+}
+
+inline bool operator == (const Word & str1, const Word & str2)
 {
 	return str1.myword == str2.myword;
 }
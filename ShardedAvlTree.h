@@ -0,0 +1,492 @@
+#ifndef SHARDED_AVL_TREE_H
+#define SHARDED_AVL_TREE_H
+
+#include "AvlTree.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// ShardedAvlTree class
+//
+// CONSTRUCTION: with optional initial shard boundaries and split size
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( x )       --> Insert x; duplicates are ignored
+// void remove( x )       --> Remove x
+// bool contains( x )     --> Return true if x is present
+// int size( )            --> Quantity of elements in all shards
+// int shardCount( )      --> Current number of range shards
+// void inOrder( f )      --> Call f( x ) on every item in sorted order
+// void inRange( lo, hi, f ) --> Call f( x ) on each lo <= x <= hi, in order
+// int retiredCount( )    --> Replaced directories not yet freed
+// ******************ERRORS********************************
+// None
+//
+// The key space is cut into contiguous ranges, each held by its own
+//  AvlTree behind its own mutex, so writers to different ranges never
+//  contend. A shard that grows past splitSize is cut at its median. A
+//  shard that drops under splitSize / 4 is merged with a neighbour only
+//  if the two together stay under splitSize / 2, so fresh halves of a
+//  split do not merge straight back; that is checked before the global
+//  resize lock is taken. The boundaries given to the constructor are
+//  never merged away.
+//
+// The shard directory is immutable once published and swapped with an
+//  atomic pointer; an operation that wakes up on a shard retired by a
+//  concurrent split/merge just retries against the new directory.
+//  Readers pin the current epoch in a slot while they look at a
+//  directory. A replaced directory is tagged with the epoch it was
+//  retired in and freed, together with its references to retired
+//  shards, once every pinned reader started after that, so memory
+//  follows the data and not the number of splits and merges.
+//
+// Traversals lock one shard at a time and resume by key, so they see
+//  each shard consistently but not the whole tree as one snapshot.
+//  Visitors run under a shard lock and must not call back into the tree.
+template <typename Comparable>
+class ShardedAvlTree
+{
+    struct Shard
+    {
+        mutex lock;
+        AvlTree<Comparable> tree;
+        int count = 0;          // Guarded by lock
+        bool retired = false;   // Guarded by lock
+    };
+
+    struct Directory
+    {
+        vector<Comparable> lowers;          // lowers[i] is the first key of shards[i + 1]
+        vector<shared_ptr<Shard> > shards;
+    };
+
+  public:
+    explicit ShardedAvlTree( const vector<Comparable> & boundaries = vector<Comparable>( ),
+                             int theSplitSize = 1 << 16 )
+      : splitSize( theSplitSize )
+    {
+        dir.store( NULL );
+        Directory *d = new Directory;
+        d->lowers = boundaries;
+        sort( d->lowers.begin( ), d->lowers.end( ) );
+        d->lowers.erase( unique( d->lowers.begin( ), d->lowers.end( ) ), d->lowers.end( ) );
+        chosen = d->lowers;
+        for( size_t i = 0; i <= d->lowers.size( ); i++ )
+            d->shards.push_back( make_shared<Shard>( ) );
+        publish( d );
+    }
+
+    ShardedAvlTree( const ShardedAvlTree & ) = delete;
+    ShardedAvlTree & operator=( const ShardedAvlTree & ) = delete;
+
+    /**
+     * Insert x into its shard; duplicates are ignored.
+     */
+    void insert( const Comparable & x )
+    {
+        for( ;; )
+        {
+            shared_ptr<Shard> s = shardFor( x );
+            bool grow;
+            {
+                lock_guard<mutex> held( s->lock );
+                if( s->retired )
+                    continue;
+                if( s->tree.contains( x ) )
+                    return;
+                s->tree.insert( x );
+                grow = ++s->count > splitSize;
+            }
+            if( grow )
+                split( s );
+            return;
+        }
+    }
+
+    /**
+     * Remove x from its shard. Nothing is done if x is not found.
+     */
+    void remove( const Comparable & x )
+    {
+        for( ;; )
+        {
+            shared_ptr<Shard> s = shardFor( x );
+            bool shrink;
+            {
+                lock_guard<mutex> held( s->lock );
+                if( s->retired )
+                    continue;
+                if( !s->tree.contains( x ) )
+                    return;
+                s->tree.remove( x );
+                shrink = --s->count < splitSize / 4;
+            }
+            if( shrink && mergeable( s ) )
+                merge( s );
+            return;
+        }
+    }
+
+    /**
+     * Returns true if x is found in its shard.
+     */
+    bool contains( const Comparable & x ) const
+    {
+        for( ;; )
+        {
+            shared_ptr<Shard> s = shardFor( x );
+            lock_guard<mutex> held( s->lock );
+            if( !s->retired )
+                return s->tree.contains( x );
+        }
+    }
+
+    /**
+     * Return number of elements over all shards.
+     */
+    int size( ) const
+    {
+        for( ;; )
+        {
+            Pin pinned = pin( );
+            const Directory *d = dir.load( );
+            int total = 0;
+            size_t i = 0;
+            for( ; i < d->shards.size( ); i++ )
+            {
+                lock_guard<mutex> held( d->shards[i]->lock );
+                if( d->shards[i]->retired )
+                    break;   // Raced with a split/merge; recount
+                total += d->shards[i]->count;
+            }
+            if( i == d->shards.size( ) )
+                return total;
+        }
+    }
+
+    int shardCount( ) const
+    {
+        Pin pinned = pin( );
+        return dir.load( )->shards.size( );
+    }
+
+    /**
+     * Call visit( x ) for every item in sorted order.
+     */
+    template <typename Visitor>
+    void inOrder( Visitor && visit ) const
+    {
+        walk( NULL, NULL, visit );
+    }
+
+    /**
+     * Call visit( x ) for every item with lo <= x <= hi, in sorted order.
+     *  Only the shards overlapping [lo, hi] are locked.
+     */
+    template <typename Visitor>
+    void inRange( const Comparable & lo, const Comparable & hi, Visitor && visit ) const
+    {
+        walk( &lo, &hi, visit );
+    }
+
+    /**
+     * Return number of replaced directories still waiting to be freed.
+     */
+    int retiredCount( ) const
+    {
+        lock_guard<mutex> resizing( resizeLock );
+        return retired.size( );
+    }
+
+    ~ShardedAvlTree( )
+    {
+        delete dir.load( );
+    }
+
+  private:
+    static const int READER_SLOTS = 64;    // Most readers pinned at once
+
+    struct alignas( 64 ) ReaderSlot
+    {
+        atomic<unsigned long> epoch { 0 };   // 0 when idle
+    };
+
+    /**
+     * Keeps the calling thread's epoch pinned until it goes away
+     */
+    class Pin
+    {
+      public:
+        explicit Pin( atomic<unsigned long> *theSlot ) : slot( theSlot ) { }
+        Pin( Pin && other ) : slot( other.slot ) { other.slot = NULL; }
+        Pin( const Pin & ) = delete;
+        Pin & operator=( const Pin & ) = delete;
+        ~Pin( )
+        {
+            if( slot != NULL )
+                slot->store( 0, memory_order_release );
+        }
+
+      private:
+        atomic<unsigned long> *slot;
+    };
+
+    struct Retired
+    {
+        unsigned long epoch;                 // Epoch it was replaced in
+        unique_ptr<const Directory> directory;
+    };
+
+    atomic<const Directory *> dir;
+    mutable mutex resizeLock;                // Serializes split/merge
+    atomic<unsigned long> epoch { 1 };
+    mutable ReaderSlot readers[ READER_SLOTS ];
+    vector<Retired> retired;                 // Guarded by resizeLock
+    vector<Comparable> chosen;               // Constructor's boundaries, sorted
+    int splitSize;
+
+    static size_t route( const Directory & d, const Comparable & x )
+    {
+        return upper_bound( d.lowers.begin( ), d.lowers.end( ), x ) - d.lowers.begin( );
+    }
+
+    /**
+     * Pin the current epoch so no directory seen from here on is freed.
+     *  Each thread starts at its own slot so readers rarely share a line.
+     */
+    Pin pin( ) const
+    {
+        static thread_local unsigned int hint = hash<thread::id>( )( this_thread::get_id( ) );
+        for( unsigned int i = hint; ; i++ )
+        {
+            atomic<unsigned long> & slot = readers[ i % READER_SLOTS ].epoch;
+            unsigned long idle = 0;
+            if( slot.load( memory_order_relaxed ) == 0 &&
+                slot.compare_exchange_strong( idle, epoch.load( ) ) )
+            {
+                // Order the pin before the directory is read
+                atomic_thread_fence( memory_order_seq_cst );
+                hint = i % READER_SLOTS;
+                return Pin( &slot );
+            }
+            if( i - hint >= READER_SLOTS )
+                this_thread::yield( );
+        }
+    }
+
+    /**
+     * The shard x routes to in the current directory.
+     */
+    shared_ptr<Shard> shardFor( const Comparable & x ) const
+    {
+        Pin pinned = pin( );
+        const Directory *d = dir.load( );
+        return d->shards[ route( *d, x ) ];
+    }
+
+    /**
+     * Make d the current directory and retire the one it replaces.
+     *  Caller holds resizeLock (or is the constructor).
+     */
+    void publish( Directory *d )
+    {
+        const Directory *old = dir.exchange( d );
+        if( old == NULL )
+            return;
+        retired.push_back( Retired{ epoch.fetch_add( 1 ), unique_ptr<const Directory>( old ) } );
+        reclaim( );
+    }
+
+    /**
+     * Internal method to free retired directories no pinned reader can see.
+     *  Caller holds resizeLock.
+     */
+    void reclaim( )
+    {
+        atomic_thread_fence( memory_order_seq_cst );
+        unsigned long oldest = epoch.load( );
+        for( int i = 0; i < READER_SLOTS; i++ )
+        {
+            unsigned long e = readers[i].epoch.load( );
+            if( e != 0 && e < oldest )
+                oldest = e;
+        }
+        size_t kept = 0;
+        for( size_t i = 0; i < retired.size( ); i++ )
+            if( !( retired[i].epoch < oldest ) )
+                retired[ kept++ ] = std::move( retired[i] );
+        retired.resize( kept );
+    }
+
+    static size_t indexOf( const Directory & d, const shared_ptr<Shard> & s )
+    {
+        return find( d.shards.begin( ), d.shards.end( ), s ) - d.shards.begin( );
+    }
+
+    /**
+     * Fill a fresh shard from sorted items.
+     */
+    static shared_ptr<Shard> build( typename vector<Comparable>::const_iterator first,
+                                    typename vector<Comparable>::const_iterator last )
+    {
+        shared_ptr<Shard> s = make_shared<Shard>( );
+        for( ; first != last; ++first )
+            s->tree.insert( *first );
+        s->count = s->tree.size( );
+        return s;
+    }
+
+    /**
+     * Internal method to cut an oversized shard at its median.
+     */
+    void split( const shared_ptr<Shard> & s )
+    {
+        lock_guard<mutex> resizing( resizeLock );
+        const Directory *d = dir.load( memory_order_acquire );
+        lock_guard<mutex> held( s->lock );
+        if( s->retired || s->count <= splitSize )
+            return;
+
+        vector<Comparable> items;
+        items.reserve( s->count );
+        s->tree.copyInOrder( back_inserter( items ) );
+        typename vector<Comparable>::const_iterator mid = items.begin( ) + items.size( ) / 2;
+
+        size_t i = indexOf( *d, s );
+        Directory *next = new Directory( *d );
+        next->lowers.insert( next->lowers.begin( ) + i, *mid );
+        next->shards[i] = build( items.begin( ), mid );
+        next->shards.insert( next->shards.begin( ) + i + 1, build( mid, items.end( ) ) );
+
+        s->retired = true;
+        s->tree.makeEmpty( );
+        publish( next );
+    }
+
+    /**
+     * Internal method to check, without resizeLock, whether s has a
+     *  neighbour it could merge with. Shards are locked one at a time,
+     *  so the answer is only a hint; mergePair checks again.
+     */
+    bool mergeable( const shared_ptr<Shard> & s ) const
+    {
+        Pin pinned = pin( );
+        const Directory *d = dir.load( );
+        size_t i = indexOf( *d, s );
+        if( i == d->shards.size( ) )
+            return false;
+        return ( i + 1 < d->shards.size( ) && pairFits( *d, i ) ) ||
+               ( i > 0 && pairFits( *d, i - 1 ) );
+    }
+
+    /**
+     * Internal method to test whether shards left and left + 1 of d may
+     *  be merged, reading each count under its own lock.
+     */
+    bool pairFits( const Directory & d, size_t left ) const
+    {
+        if( binary_search( chosen.begin( ), chosen.end( ), d.lowers[ left ] ) )
+            return false;
+        int total = 0;
+        for( size_t j = left; j <= left + 1; j++ )
+        {
+            lock_guard<mutex> held( d.shards[ j ]->lock );
+            total += d.shards[ j ]->count;
+        }
+        return total < splitSize / 2;
+    }
+
+    /**
+     * Internal method to fold an undersized shard into a neighbour,
+     *  trying the right one first, then the left one.
+     */
+    void merge( const shared_ptr<Shard> & s )
+    {
+        lock_guard<mutex> resizing( resizeLock );
+        const Directory *d = dir.load( memory_order_acquire );
+        size_t i = indexOf( *d, s );
+        if( i == d->shards.size( ) )
+            return;   // Already retired by an earlier resize
+
+        if( i + 1 < d->shards.size( ) && mergePair( d, i ) )
+            return;
+        if( i > 0 )
+            mergePair( d, i - 1 );
+    }
+
+    /**
+     * Internal method to merge shards left and left + 1 of d if they fit.
+     *  Caller holds resizeLock. Returns true if merged.
+     */
+    bool mergePair( const Directory *d, size_t left )
+    {
+        // Owned here: publishing frees d, and with it d's references
+        shared_ptr<Shard> keepA = d->shards[left], keepB = d->shards[left + 1];
+        Shard & a = *keepA;
+        Shard & b = *keepB;
+        if( binary_search( chosen.begin( ), chosen.end( ), d->lowers[ left ] ) )
+            return false;
+        lock_guard<mutex> heldA( a.lock );
+        lock_guard<mutex> heldB( b.lock );
+        if( a.count + b.count >= splitSize / 2 )
+            return false;
+
+        vector<Comparable> items;
+        items.reserve( a.count + b.count );
+        a.tree.copyInOrder( back_inserter( items ) );
+        b.tree.copyInOrder( back_inserter( items ) );
+
+        Directory *next = new Directory( *d );
+        next->lowers.erase( next->lowers.begin( ) + left );
+        next->shards.erase( next->shards.begin( ) + left + 1 );
+        next->shards[left] = build( items.begin( ), items.end( ) );
+
+        a.retired = b.retired = true;
+        a.tree.makeEmpty( );
+        b.tree.makeEmpty( );
+        publish( next );
+        return true;
+    }
+
+    /**
+     * Internal method to visit [*lo, *hi] (NULL for unbounded) shard by shard.
+     *  The cursor is the first key not yet covered, so a split or merge
+     *  between shards only changes which shard the next key routes to.
+     */
+    template <typename Visitor>
+    void walk( const Comparable *lo, const Comparable *hi, Visitor & visit ) const
+    {
+        bool haveCursor = lo != NULL;
+        Comparable cursor = haveCursor ? *lo : Comparable( );
+        for( ;; )
+        {
+            Pin pinned = pin( );
+            const Directory *d = dir.load( );
+            size_t i = haveCursor ? route( *d, cursor ) : 0;
+            Shard & s = *d->shards[i];
+            {
+                lock_guard<mutex> held( s.lock );
+                if( s.retired )
+                    continue;
+                if( !s.tree.isEmpty( ) )
+                {
+                    const Comparable & from = haveCursor ? cursor : s.tree.findMin( );
+                    const Comparable & to = hi != NULL ? *hi : s.tree.findMax( );
+                    if( !( to < from ) )
+                        s.tree.inRange( from, to, visit );
+                }
+            }
+            if( i == d->lowers.size( ) || ( hi != NULL && *hi < d->lowers[i] ) )
+                return;
+            cursor = d->lowers[i];
+            haveCursor = true;
+        }
+    }
+};
+
+#endif